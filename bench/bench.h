@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Helpers of the benchmarks of `make bench`: each measure is run many times
+ * and the median is reported, so a preempted run does not move the result.
+ */
+
+static inline long long bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bench_compare(const void *a, const void *b) {
+  long long x = *(const long long *)a, y = *(const long long *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Median of the durations of the runs, the array is sorted.
+ *
+ * @return The median, in microseconds
+ */
+static inline double bench_median_us(long long *durations, int nb_runs) {
+  qsort(durations, nb_runs, sizeof(*durations), bench_compare);
+  return durations[nb_runs / 2] / 1000.0;
+}
+
+#endif // !BENCH_H
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+// personal files
+#include "../include/pokefetch.h"
+#include "bench.h"
+
+#define NB_RUNS 20
+
+/**
+ * @brief Time the grid of a generation, written to /dev/null.
+ *
+ * @return The median time of the grid, in microseconds, or -1 if it failed
+ */
+static double bench_grid(struct Pokefetch *ctx, const int *ids, int nb_ids,
+                         enum ColorMode mode, FILE *out) {
+  struct GridOptions options = {"regular", "fr", mode, 80};
+  long long durations[NB_RUNS];
+  for (int run = 0; run < NB_RUNS; run++) {
+    long long start = bench_now_ns();
+    if (pokefetch_render_grid(ctx, ids, nb_ids, &options, out) != 0)
+      return -1;
+    durations[run] = bench_now_ns() - start;
+  }
+  return bench_median_us(durations, NB_RUNS);
+}
+
+int main(int argc, char **argv) {
+  const char *data_dir = argc > 1 ? argv[1] : NULL;
+  struct Pokefetch *ctx = pokefetch_new(data_dir, NULL);
+  FILE *out = fopen("/dev/null", "w");
+  if (ctx == NULL || out == NULL) {
+    fprintf(stderr, "Error in bench_grid.c: Failed to start.\n");
+    pokefetch_free(ctx);
+    return 1;
+  }
+
+  // The first generation, as `--grid --gen 1` in a 80 columns terminal
+  struct DexFilter filter = {0};
+  filter.gens = 1;
+  int ids[1024];
+  int nb_ids = pokefetch_select(ctx, &filter, ids, 1024);
+
+  int status = 0;
+  enum ColorMode modes[] = {COLOR_TRUE, COLOR_256, COLOR_16};
+  const char *names[] = {"truecolor", "256", "16"};
+  printf("grid of %d icons, 80 columns\n", nb_ids);
+  for (int i = 0; i < 3 && nb_ids > 0; i++) {
+    double us = bench_grid(ctx, ids, nb_ids, modes[i], out);
+    if (us < 0) {
+      fprintf(stderr, "Error in bench_grid.c: The grid failed.\n");
+      status = 1;
+      break;
+    }
+    printf("  %-10s %8.2f ms\n", names[i], us / 1000);
+  }
+  if (nb_ids == 0) {
+    fprintf(stderr, "Error in bench_grid.c: No local data.\n");
+    status = 1;
+  }
+
+  fclose(out);
+  pokefetch_free(ctx);
+  return status;
+}
@@ -0,0 +1,117 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/icon.h"
+#include "../include/memstats.h"
+#include "bench.h"
+
+#define MAX_ICONS 2048
+#define NB_RUNS 20
+
+/**
+ * @struct PackedIcon
+ * @brief Content of a `.pki` file.
+ */
+struct PackedIcon {
+  unsigned char *data; /**< Content of the file */
+  size_t size;         /**< Size of the file */
+};
+
+/**
+ * @brief Read every `.pki` file of a directory.
+ *
+ * @return The number of icons read
+ */
+static int read_icons(const char *dirname, struct PackedIcon *icons, int max) {
+  DIR *dir = opendir(dirname);
+  if (dir == NULL)
+    return 0;
+
+  int count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) && count < max) {
+    size_t len = strlen(entry->d_name);
+    if (len < 4 || strcmp(entry->d_name + len - 4, ".pki") != 0)
+      continue;
+    char path[2048];
+    snprintf(path, sizeof(path), "%s/%s", dirname, entry->d_name);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+      continue;
+    fseek(file, 0, SEEK_END);
+    icons[count].size = ftell(file);
+    rewind(file);
+    icons[count].data = malloc(icons[count].size);
+    if (icons[count].data &&
+        fread(icons[count].data, 1, icons[count].size, file) ==
+            icons[count].size)
+      count++;
+    else
+      free(icons[count].data);
+    fclose(file);
+  }
+  closedir(dir);
+  return count;
+}
+
+/**
+ * @brief Time the decoding of every icon in a color mode.
+ *
+ * @param text_size Where the size of the decoded icons is stored
+ * @return The median time to decode all of them, in microseconds
+ */
+static double bench_decode(const struct PackedIcon *icons, int nb_icons,
+                           enum ColorMode mode, size_t *text_size) {
+  long long durations[NB_RUNS];
+  for (int run = 0; run < NB_RUNS; run++) {
+    *text_size = 0;
+    long long start = bench_now_ns();
+    for (int i = 0; i < nb_icons; i++) {
+      char *text = decode_icon(icons[i].data, icons[i].size, mode, 0);
+      if (text)
+        *text_size += strlen(text);
+      mem_free(text);
+    }
+    durations[run] = bench_now_ns() - start;
+  }
+  return bench_median_us(durations, NB_RUNS);
+}
+
+int main(int argc, char **argv) {
+  const char *data_dir = argc > 1 ? argv[1] : "assets";
+  char dirname[1024];
+  snprintf(dirname, sizeof(dirname), "%s/icons/regular", data_dir);
+
+  static struct PackedIcon icons[MAX_ICONS];
+  int nb_icons = read_icons(dirname, icons, MAX_ICONS);
+  if (nb_icons == 0) {
+    fprintf(stderr, "Error in bench_icons.c: No .pki icon in %s, run make "
+                    "icon.\n", dirname);
+    return 1;
+  }
+  size_t packed_size = 0;
+  for (int i = 0; i < nb_icons; i++)
+    packed_size += icons[i].size;
+
+  // The truecolor text is the content of the former text icons
+  size_t text_size;
+  double true_us = bench_decode(icons, nb_icons, COLOR_TRUE, &text_size);
+  size_t quantized_size;
+  double quantized_us =
+      bench_decode(icons, nb_icons, COLOR_256, &quantized_size);
+
+  printf("%d icons in %s\n", nb_icons, dirname);
+  printf("  .pki files       %10zu bytes\n", packed_size);
+  printf("  truecolor text   %10zu bytes (%.1fx)\n", text_size,
+         (double)text_size / packed_size);
+  printf("  decode truecolor %10.1f us for all, %.2f us per icon\n", true_us,
+         true_us / nb_icons);
+  printf("  decode 256       %10.1f us for all, %.2f us per icon\n",
+         quantized_us, quantized_us / nb_icons);
+
+  for (int i = 0; i < nb_icons; i++)
+    free(icons[i].data);
+  return 0;
+}
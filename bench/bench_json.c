@@ -0,0 +1,135 @@
+#include <cjson/cJSON.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/json.h"
+#include "../include/memstats.h"
+#include "bench.h"
+
+// Allocations of the parse being measured, through the hooks of both parsers
+static long allocs = 0;
+
+static void *count_malloc(size_t size) {
+  allocs++;
+  return malloc(size);
+}
+
+static void *count_realloc(void *ptr, size_t size) {
+  allocs++;
+  return realloc(ptr, size);
+}
+
+/**
+ * @brief Read a whole file, NUL terminated for cJSON_Parse().
+ */
+static char *read_file(const char *filename, size_t *size) {
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL)
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  char *text = malloc(*size + 1);
+  if (text && fread(text, 1, *size, file) != *size) {
+    free(text);
+    text = NULL;
+  }
+  fclose(file);
+  if (text)
+    text[*size] = '\0';
+  return text;
+}
+
+/**
+ * @brief Time cJSON_Parse(), json_parse() and json_parse_temp() on a
+ * document, each followed by the release of its tree or tape.
+ *
+ * @return 0 if every parser read the document, otherwise 1
+ */
+static int bench_file(const char *filename) {
+  size_t size;
+  char *text = read_file(filename, &size);
+  if (text == NULL) {
+    fprintf(stderr, "Error in bench_json.c: Cannot read %s.\n", filename);
+    return 1;
+  }
+
+  // About a second per parser for the largest documents
+  int nb_runs = size > 0 ? 20000000 / size : 20000;
+  if (nb_runs < 50)
+    nb_runs = 50;
+  if (nb_runs > 20000)
+    nb_runs = 20000;
+  long long *durations = malloc(nb_runs * sizeof(*durations));
+  if (durations == NULL) {
+    free(text);
+    return 1;
+  }
+
+  int status = 0;
+  long cjson_allocs = 0, tape_allocs = 0, temp_allocs = 0;
+  for (int i = 0; i < nb_runs && status == 0; i++) {
+    allocs = 0;
+    long long start = bench_now_ns();
+    cJSON *json = cJSON_Parse(text);
+    cJSON_Delete(json);
+    durations[i] = bench_now_ns() - start;
+    cjson_allocs = allocs;
+    status = json == NULL;
+  }
+  double cjson_us = bench_median_us(durations, nb_runs);
+
+  for (int i = 0; i < nb_runs && status == 0; i++) {
+    struct JsonDoc doc;
+    allocs = 0;
+    long long start = bench_now_ns();
+    status = json_parse(&doc, text, size);
+    json_free(&doc);
+    durations[i] = bench_now_ns() - start;
+    tape_allocs = allocs;
+  }
+  double tape_us = bench_median_us(durations, nb_runs);
+
+  // The tape of the thread only grows on the first run
+  for (int i = 0; i < nb_runs && status == 0; i++) {
+    struct JsonDoc doc;
+    allocs = 0;
+    long long start = bench_now_ns();
+    status = json_parse_temp(&doc, text, size);
+    json_free(&doc);
+    durations[i] = bench_now_ns() - start;
+    temp_allocs = allocs;
+  }
+  double temp_us = bench_median_us(durations, nb_runs);
+
+  if (status != 0)
+    fprintf(stderr, "Error in bench_json.c: %s is not valid JSON.\n",
+            filename);
+  else
+    printf("%-32s %9zu %10.1f %8ld %10.1f %8ld %10.1f %8ld %7.1fx\n",
+           filename, size, cjson_us, cjson_allocs, tape_us, tape_allocs,
+           temp_us, temp_allocs, cjson_us / temp_us);
+  free(durations);
+  free(text);
+  return status;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s file.json...\n", argv[0]);
+    return 1;
+  }
+
+  cJSON_InitHooks(&(cJSON_Hooks){count_malloc, free});
+  mem_malloc = count_malloc;
+  mem_realloc = count_realloc;
+
+  printf("%-32s %9s %10s %8s %10s %8s %10s %8s %8s\n", "document", "bytes",
+         "cJSON us", "allocs", "tape us", "allocs", "thread us", "allocs",
+         "speedup");
+  int status = 0;
+  for (int i = 1; i < argc; i++)
+    status |= bench_file(argv[i]);
+  return status;
+}
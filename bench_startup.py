@@ -0,0 +1,292 @@
+import argparse
+import csv
+import datetime
+import json
+import os
+import platform
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import get_icons
+import get_index
+
+# Species of the fixture backend, the cards are drawn among them
+SPECIES = 151
+# Cards shown by each scenario, on top of the fixture backend and data
+SCENARIOS = {
+    "local": [],                          # default card, no request
+    "api": ["--fields", "all", "-e"],     # every field and the evolution line
+}
+# Results of every run, kept in the repository so releases can be compared.
+# Timings only compare between rows of the same host
+RESULTS = "bench/startup.csv"
+FIELDS = ["date", "commit", "host", "scenario", "cache", "runs", "p50_ms",
+          "p95_ms", "p99_ms", "link_ms", "data_ms", "render_ms", "exit_ms"]
+
+
+def alias(name):
+    """
+    Name of the icon of a pokémon, as icon_alias() in parser.c
+    """
+    name = name.replace("♀", "-f").replace("♂", "-m").replace("é", "e")
+    return re.sub(r"[.':]", "", name).replace(" ", "-").lower()
+
+
+def sprite(id):
+    """
+    Pixels of a 40x40 sprite, an ellipse in the colors of the ID
+    """
+    colors = []
+    for y in range(40):
+        row = []
+        for x in range(40):
+            if ((x - 20) / 18) ** 2 + ((y - 20) / 14) ** 2 > 1:
+                row.append(get_icons.TRANSPARENT)
+            else:
+                shade = (x + y) // 8
+                row.append(f"2;{(id * 37 + shade * 20) % 256};{(id * 91) % 256};{(shade * 50) % 256}m")
+        colors.append(row)
+    return colors
+
+
+def make_data(path, names):
+    """
+    Data directory of the fixture: the local data of the tree, an index and
+    an icon at every scale for each species of the backend
+    """
+    shutil.copy("assets/pokemons.json", f"{path}/pokemons.json")
+    with open(f"{path}/index.bin", "wb") as f:
+        count = len(names)
+        f.write(b"PKDX" + struct.pack("<BBH", 1, 0, count))
+        f.write(bytes(t for id in range(1, count + 1) for t in (id % 18, 0xFF if id % 2 else (id + 1) % 18)))
+        f.write(bytes(1 + min(id // 152, 8) for id in range(1, count + 1)))
+        f.write(bytes(get_index.LEGENDARY if id % 50 == 0 else 0 for id in range(1, count + 1)))
+        f.write(bytes((id + i * 10) % 256 for id in range(1, count + 1) for i in range(6)))
+
+    for scale in ["regular"] + list(get_icons.SCALES):
+        os.makedirs(f"{path}/icons/{scale}")
+    for id in range(1, SPECIES + 1):
+        colors = sprite(id)
+        name = alias(names[id - 1])
+        with open(f"{path}/icons/regular/{name}.pki", "wb") as f:
+            f.write(get_icons.pack_icon(colors))
+        for scale, data in get_icons.scaled_icons(colors):
+            with open(f"{path}/icons/{scale}/{name}.pki", "wb") as f:
+                f.write(data)
+
+
+class Backend(BaseHTTPRequestHandler):
+    """
+    Fixture PokéAPI: generated pokemon, pokemon-species and evolution-chain
+    documents, in the shape of the real ones
+    """
+    names = []
+    api = ""
+
+    def document(self, resource, id):
+        name = alias(self.names[id - 1])
+        if resource == "pokemon":
+            return {
+                "id": id, "name": name, "height": id % 20 + 1, "weight": id * 7,
+                "types": [{"slot": 1, "type": {"name": get_index.TYPES[id % 18]}}],
+                "stats": [{"base_stat": (id + i * 10) % 256, "stat": {"name": f"stat-{i}"}} for i in range(6)],
+                "abilities": [{"ability": {"name": "overgrow"}, "is_hidden": False},
+                              {"ability": {"name": "chlorophyll"}, "is_hidden": True}],
+            }
+        if resource == "pokemon-species":
+            return {
+                "id": id, "name": name, "is_legendary": id % 50 == 0, "is_mythical": False,
+                "generation": {"name": "generation-i"},
+                "names": [{"name": self.names[id - 1], "language": {"name": lang}} for lang in ("fr", "en")],
+                "genera": [{"genus": "Pokémon Graine", "language": {"name": "fr"}},
+                           {"genus": "Seed Pokémon", "language": {"name": "en"}}],
+                "flavor_text_entries": [{"flavor_text": f"Description\nof {name} in {version}.",
+                                         "language": {"name": lang}, "version": {"name": version}}
+                                        for version in ("x", "omega-ruby") for lang in ("en", "fr")],
+                "evolution_chain": {"url": f"{self.api}/evolution-chain/{(id + 2) // 3}/"},
+            }
+        # Lines of three species
+        first = id * 3 - 2
+        link = {}
+        for member in reversed(range(first, min(first + 3, SPECIES + 1))):
+            link = {"species": {"name": alias(self.names[member - 1]),
+                                "url": f"{self.api}/pokemon-species/{member}/"},
+                    "evolves_to": [link] if link else []}
+        return {"id": id, "chain": link}
+
+    def do_GET(self):
+        match = re.fullmatch(r"/api/v2/(pokemon|pokemon-species|evolution-chain)/(\d+)/?", self.path)
+        if match == None or not 1 <= int(match[2]) <= SPECIES:
+            self.send_response(404)
+            self.end_headers()
+            return
+        data = json.dumps(self.document(match[1], int(match[2])), ensure_ascii=False).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, *args):
+        pass
+
+
+def loaded_files(binary, data):
+    """
+    Files read by a launch: the executable, its libraries and the data
+    """
+    files = [binary]
+    ldd = subprocess.run(["ldd", binary], capture_output=True, text=True).stdout
+    files += re.findall(r"(/\S+) \(0x", ldd)
+    for root, _, names in os.walk(data):
+        files += [os.path.join(root, name) for name in names]
+    return files
+
+
+def drop_cache(files):
+    """
+    Evict the files of a launch from the page cache, with drop_caches when
+    allowed, else file by file (pages mapped by other processes stay)
+
+    Return the method used
+    """
+    try:
+        os.sync()
+        with open("/proc/sys/vm/drop_caches", "w") as f:
+            f.write("1\n")
+        return "drop_caches"
+    except OSError:
+        pass
+    for path in files:
+        try:
+            fd = os.open(path, os.O_RDONLY)
+        except OSError:
+            continue
+        os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+        os.close(fd)
+    return "fadvise"
+
+
+def launch(binary, args, env):
+    """
+    Run the binary once with --profile
+
+    Return the milliseconds from the spawn to the exit, and of each step:
+    before main() (execve and dynamic linking), the context (curl, local
+    data, index), the card and the exit
+    """
+    with tempfile.TemporaryFile() as err:
+        start = time.monotonic_ns()
+        pid = os.posix_spawn(binary, [binary, "--profile"] + args, env, file_actions=[
+            (os.POSIX_SPAWN_OPEN, 1, os.devnull, os.O_WRONLY, 0),
+            (os.POSIX_SPAWN_DUP2, err.fileno(), 2),
+        ])
+        _, status = os.waitpid(pid, 0)
+        end = time.monotonic_ns()
+        err.seek(0)
+        output = err.read().decode(errors="replace")
+
+    match = re.search(r"profile main=(\d+) data=(\d+) render=(\d+) exit=(\d+)", output)
+    if status != 0 or match == None or match[3] == "0":
+        raise RuntimeError(f"{' '.join(args)} failed:\n{output}")
+    main, data, render = (int(match[i]) for i in range(1, 4))
+    return [(end - start) / 1e6, (main - start) / 1e6, (data - main) / 1e6,
+            (render - data) / 1e6, (end - render) / 1e6]
+
+
+def percentile(values, p, key=None):
+    values = sorted(values, key=key)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def previous_results():
+    """
+    Last stored result of each host, scenario and cache state
+    """
+    previous = {}
+    if os.path.exists(RESULTS):
+        with open(RESULTS, newline="") as f:
+            for row in csv.DictReader(f):
+                previous[(row["host"], row["scenario"], row["cache"])] = row
+    return previous
+
+
+def save_results(rows):
+    os.makedirs(os.path.dirname(RESULTS), exist_ok=True)
+    new = not os.path.exists(RESULTS)
+    with open(RESULTS, "a", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        if new:
+            writer.writeheader()
+        writer.writerows(rows)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Startup time of pokefetch, from execve to the last byte")
+    parser.add_argument("--runs", type=int, default=300, help="launches of each scenario and cache state")
+    parser.add_argument("--binary", default="./pokefetch")
+    args = parser.parse_args()
+    binary = os.path.abspath(args.binary)
+
+    with open("assets/pokemons.json") as f:
+        names = [entry["en"]["name"] for entry in json.load(f)]
+    fixture = tempfile.mkdtemp(prefix="pokefetch-bench-")
+    server = ThreadingHTTPServer(("127.0.0.1", 0), Backend)
+    try:
+        make_data(fixture, names)
+        Backend.names = names
+        Backend.api = f"http://127.0.0.1:{server.server_address[1]}/api/v2"
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+
+        # Same terminal for every launch, without tty
+        env = dict(os.environ, COLUMNS="100", LINES="40", TERM="xterm-256color")
+        files = loaded_files(binary, fixture)
+        commit = subprocess.run(["git", "describe", "--always", "--dirty"],
+                                capture_output=True, text=True).stdout.strip() or "unknown"
+        date = datetime.datetime.now().isoformat(timespec="seconds")
+        host = platform.node()
+        previous = previous_results()
+        rows = []
+
+        print(f"{'scenario':<9}{'cache':<6}{'p50':>8}{'p95':>8}{'p99':>8}  |{'link':>7}{'data':>7}{'render':>8}{'exit':>7}  (ms, steps of the median run)")
+        for scenario, options in SCENARIOS.items():
+            for cache in ("warm", "cold"):
+                method = ""
+                samples = []
+                launch(binary, options + ["--api", Backend.api, "--data-dir", fixture, "-id", "1"], env)
+                for run in range(args.runs):
+                    if cache == "cold":
+                        method = drop_cache(files)
+                    id = run % SPECIES + 1
+                    samples.append(launch(binary, options + ["--api", Backend.api, "--data-dir", fixture,
+                                                             "-id", str(id), "-s", "100000000"], env))
+                total = [s[0] for s in samples]
+                # The steps add up to the p50 launch
+                steps = percentile(samples, 50, key=lambda s: s[0])[1:]
+                row = dict(zip(FIELDS, [date, commit, host, scenario, cache, args.runs,
+                                        *(f"{v:.3f}" for v in [percentile(total, 50), percentile(total, 95),
+                                                               percentile(total, 99), *steps])]))
+                rows.append(row)
+
+                line = f"{scenario:<9}{cache:<6}{row['p50_ms']:>8}{row['p95_ms']:>8}{row['p99_ms']:>8}  |"
+                line += "".join(f"{v:>7.3f}" for v in steps[:2]) + f"{steps[2]:>8.3f}{steps[3]:>7.3f}"
+                last = previous.get((host, scenario, cache))
+                if last:
+                    delta = (float(row["p50_ms"]) / float(last["p50_ms"]) - 1) * 100
+                    line += f"  p50 {delta:+.1f}% vs {last['commit']}"
+                if method:
+                    line += f"  ({method})"
+                print(line)
+
+        save_results(rows)
+        print(f"\n[info] Results added to {RESULTS}.")
+    finally:
+        server.server_close()
+        shutil.rmtree(fixture)
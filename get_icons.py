@@ -1,4 +1,7 @@
+import glob
 import os
+import re
+import struct
 import sys
 import time
 from io import BytesIO
@@ -33,8 +36,8 @@ def getImage(url):
         return None
 
 
-def get_colors(img, gray: False):
-    size = img.getbbox()
+def get_colors(img, gray=False, box=None):
+    size = box if box != None else img.getbbox()
     colors = []
     for y in range(size[1], size[3] + 1):
         colors.append([])
@@ -57,35 +60,260 @@ def get_colors(img, gray: False):
     return colors
 
 
-def convert_to_text(colors):
-    text = ""
-    for y in range(len(colors) // 2):
-        for x in range(len(colors[y])):
-            if colors[y * 2][x] == "\x1b[0m":
-                if colors[y * 2 + 1][x] == "\x1b[0m":
-                    text += " "
-                else:
-                    text += f"\x1b[38;{colors[y * 2 + 1][x]}▄\x1b[0m"
+ANSI16 = [
+    (0, 0, 0), (205, 0, 0), (0, 205, 0), (205, 205, 0),
+    (0, 0, 238), (205, 0, 205), (0, 205, 205), (229, 229, 229),
+    (127, 127, 127), (255, 0, 0), (0, 255, 0), (255, 255, 0),
+    (92, 92, 255), (255, 0, 255), (0, 255, 255), (255, 255, 255),
+]
+CUBE_LEVELS = [0, 95, 135, 175, 215, 255]
+
+
+def distance(c1, c2):
+    return sum((a - b) ** 2 for a, b in zip(c1, c2))
+
+
+def rgb_to_256(r, g, b):
+    """
+    Nearest xterm-256 color, must stay in sync with rgb_to_256() in color.c
+    """
+    levels = [min(range(6), key=lambda i: abs(CUBE_LEVELS[i] - v)) for v in (r, g, b)]
+    cube = 16 + 36 * levels[0] + 6 * levels[1] + levels[2]
+    cube_dist = distance((r, g, b), [CUBE_LEVELS[i] for i in levels])
+
+    avg = (r + g + b) // 3
+    gray = 0 if avg < 8 else min((avg - 8 + 5) // 10, 23)
+    level = 8 + 10 * gray
+    gray_dist = distance((r, g, b), (level, level, level))
+
+    return 232 + gray if gray_dist < cube_dist else cube
+
+
+def rgb_to_16(r, g, b):
+    """
+    Nearest ANSI-16 color, must stay in sync with rgb_to_16() in color.c
+    """
+    return min(range(16), key=lambda i: (distance((r, g, b), ANSI16[i]), i))
+
+
+def shiny_colors(colors, shiny):
+    """
+    Shiny color of each color of the regular sprite, the most frequent one at
+    the same pixels of the shiny sprite
+    """
+    counts = {}
+    for row, shiny_row in zip(colors, shiny):
+        for color, shiny_color in zip(row, shiny_row):
+            if color != "\x1b[0m" and shiny_color != "\x1b[0m":
+                counts.setdefault(color, {})
+                counts[color][shiny_color] = counts[color].get(shiny_color, 0) + 1
+    return {color: max(c, key=c.get) for color, c in counts.items()}
+
+
+TRANSPARENT = "\x1b[0m"
+
+
+def palette_entry(color):
+    """
+    Color of the palette with its quantizations: [r, g, b, c256, c16]
+    """
+    r, g, b = (int(c) for c in color[2:-1].split(";"))
+    return [r, g, b, rgb_to_256(r, g, b), rgb_to_16(r, g, b)]
+
+
+def pack_icon(colors, swap={}):
+    """
+    Binary icon (.pki), see icon.h for the format: a header, the palette with
+    the shiny color of each entry, then runs of half-block cells
+    """
+    seen = []
+    for row in colors:
+        for color in row:
+            if color != TRANSPARENT and color not in seen:
+                seen.append(color)
+    # At most 255 colors, the others take the nearest one
+    palette = seen[:255]
+    index = {color: i + 1 for i, color in enumerate(palette)}
+    for color in seen[255:]:
+        nearest = min(palette, key=lambda p: distance(palette_entry(color)[:3], palette_entry(p)[:3]))
+        index[color] = index[nearest]
+    index[TRANSPARENT] = 0
+
+    height = len(colors) // 2
+    width = len(colors[0]) if height > 0 else 0
+    data = bytearray(b"PKI\x01")
+    data += struct.pack("<HHBB", width, height, len(palette), 0)
+    for color in palette:
+        data += bytes(palette_entry(color) + palette_entry(swap.get(color, color)))
+
+    cells = [(index[colors[y * 2][x]], index[colors[y * 2 + 1][x]])
+             for y in range(height) for x in range(width)]
+    i = 0
+    while i < len(cells):
+        count = 1
+        while i + count < len(cells) and count < 255 and cells[i + count] == cells[i]:
+            count += 1
+        data += bytes([count, cells[i][0], cells[i][1]])
+        i += count
+    return bytes(data)
+
+
+def unpack_icon(data):
+    """
+    Pixels and shiny colors of a binary icon, the reverse of pack_icon()
+    """
+    width, height, nb_colors = struct.unpack_from("<HHB", data, 4)
+    regular = [TRANSPARENT]
+    swap = {}
+    for i in range(nb_colors):
+        e = data[10 + i * 10:20 + i * 10]
+        color = f"2;{e[0]};{e[1]};{e[2]}m"
+        regular.append(color)
+        swap[color] = f"2;{e[5]};{e[6]};{e[7]}m"
+    cells = []
+    read = 10 + nb_colors * 10
+    while len(cells) < width * height:
+        count, top, bottom = data[read:read + 3]
+        cells += [(regular[top], regular[bottom])] * count
+        read += 3
+    colors = []
+    for y in range(height):
+        row = cells[y * width:(y + 1) * width]
+        colors += [[top for top, _ in row], [bottom for _, bottom in row]]
+    return colors, swap
+
+
+def downscale(colors, factor):
+    """
+    Box filter: each block of factor x factor pixels becomes the average of
+    its opaque pixels, or a transparent pixel if most of the block is
+    transparent
+    """
+    height = (len(colors) + factor - 1) // factor
+    width = (len(colors[0]) + factor - 1) // factor if colors else 0
+    result = []
+    for y in range(height):
+        row = []
+        for x in range(width):
+            block = [colors[j][i]
+                     for j in range(y * factor, min((y + 1) * factor, len(colors)))
+                     for i in range(x * factor, min((x + 1) * factor, len(colors[j])))]
+            opaque = [[int(v) for v in c[2:-1].split(";")] for c in block if c != TRANSPARENT]
+            if len(opaque) * 2 < factor * factor:
+                row.append(TRANSPARENT)
             else:
-                if colors[y * 2 + 1][x] == "\x1b[0m":
-                    text += f"\x1b[38;{colors[y * 2][x]}▀\x1b[0m"
-                else:
-                    text += f"\x1b[38;{colors[y * 2][x]}\x1b[48;{colors[y * 2 + 1][x]}▀\x1b[0m"
-        text += "\n"
-    return text
+                r, g, b = (round(sum(c[i] for c in opaque) / len(opaque)) for i in range(3))
+                row.append(f"2;{r};{g};{b}m")
+        result.append(row)
+    # Cells are two pixels high
+    if len(result) % 2:
+        result.append([TRANSPARENT] * width)
+    return result
+
+
+SCALES = {"half": 2, "quarter": 4}
+
+
+def scaled_icons(colors, swap={}):
+    """
+    Binary icon at each smaller scale, the shiny sprite being downscaled
+    with the regular one so that the palette swap still matches
+    """
+    shiny = [[swap.get(color, color) for color in row] for row in colors]
+    for scale, factor in SCALES.items():
+        small = downscale(colors, factor)
+        small_swap = shiny_colors(small, downscale(shiny, factor)) if swap else {}
+        yield scale, pack_icon(small, small_swap)
+
+
+def colors_from_text(text, pal=""):
+    """
+    Pixels and shiny colors of an icon in the former text format (.txt and
+    .pal), to convert it without downloading it again
+    """
+    colors = []
+    cell = re.compile(r" |\x1b\[38;(2;[0-9;]+m)(?:\x1b\[48;(2;[0-9;]+m))?([▀▄])\x1b\[0m")
+    for line in text.split("\n"):
+        if line == "":
+            continue
+        top, bottom = [], []
+        for match in cell.finditer(line):
+            fg, bg, block = match.groups()
+            if fg == None:
+                top.append(TRANSPARENT)
+                bottom.append(TRANSPARENT)
+            elif block == "▄":
+                top.append(TRANSPARENT)
+                bottom.append(fg)
+            else:
+                top.append(fg)
+                bottom.append(bg if bg != None else TRANSPARENT)
+        colors += [top, bottom]
+    swap = {}
+    for line in pal.split("\n"):
+        v = line.split()
+        if len(v) == 10:
+            swap[f"2;{v[0]};{v[1]};{v[2]}m"] = f"2;{v[5]};{v[6]};{v[7]}m"
+    return colors, swap
+
+
+def savefile(name, data, scale="regular"):
+    if name == "unknown" and scale == "regular":
+        path = f"assets/icons/{name}"
+    else:
+        path = f"assets/icons/{scale}/{name}"
+
+    with open(f"{path}.pki", "wb") as f:
+        f.write(data)
+
 
+def save_icon(name, colors, swap={}):
+    """
+    Save an icon at full scale and at every smaller scale
+    """
+    savefile(name, pack_icon(colors, swap))
+    for scale, data in scaled_icons(colors, swap):
+        savefile(name, data, scale)
 
-def savefile(name, text, shiny):
-    if name == "unknown":
-        with open(f"assets/icons/{name}.txt", "w") as f:
-            f.write(text)
-        return
 
-    with open(f"assets/icons/{'shiny' if shiny else 'regular'}/{name}.txt", "w") as f:
-        f.write(text)
+def convert_icons():
+    """
+    Convert the icons in the former text format to binary icons, and add the
+    smaller scales to the binary icons without them
+    """
+    for scale in SCALES:
+        os.makedirs(f"assets/icons/{scale}", exist_ok=True)
+    paths = glob.glob("assets/icons/regular/*.txt") + glob.glob("assets/icons/unknown.txt")
+    paths += [path for path in glob.glob("assets/icons/regular/*.pki") + glob.glob("assets/icons/unknown.pki")
+              if not os.path.exists(f"assets/icons/quarter/{os.path.basename(path)}")]
+    for n, path in enumerate(paths):
+        base = path[:-4]
+        name = os.path.basename(base)
+        if path.endswith(".pki"):
+            with open(path, "rb") as f:
+                colors, swap = unpack_icon(f.read())
+            for scale, data in scaled_icons(colors, swap):
+                savefile(name, data, scale)
+        else:
+            with open(path) as f:
+                text = f.read()
+            pal = ""
+            if os.path.exists(f"{base}.pal"):
+                with open(f"{base}.pal") as f:
+                    pal = f.read()
+                os.remove(f"{base}.pal")
+            colors, swap = colors_from_text(text, pal)
+            save_icon(name, colors, swap)
+            os.remove(path)
+        loading_bar(n + 1, len(paths), flavour=f"- {name}" + " "*10)
+    print(f"\n[info] [{len(paths)}] pokémon icons converted.")
 
 
 if __name__ == "__main__":
+    if "--convert" in sys.argv:
+        convert_icons()
+        sys.exit(0)
+
     json_data = requests.get(
         "https://raw.githubusercontent.com/msikma/pokesprite/master/data/pokemon.json"
     ).json()
@@ -104,35 +332,38 @@ if __name__ == "__main__":
             .replace("♂", "-m")
             .replace("é", "e")
         )
-        shiny = False
-        for i in range(2):
-            if os.path.exists(f"assets/icons/{'shiny' if shiny else 'regular'}/{name}.txt"):
-                total += 1
-                continue
+        if os.path.exists(f"assets/icons/regular/{name}.pki"):
+            total += 1
+        else:
+            # Only the regular sprite is stored, the shiny one is a palette swap
             img = getImage(
-                f"https://github.com/msikma/pokesprite/raw/master/pokemon-gen8/{'shiny' if shiny else 'regular'}/{name}.png"
+                f"https://github.com/msikma/pokesprite/raw/master/pokemon-gen8/regular/{name}.png"
+            )
+            shiny_img = getImage(
+                f"https://github.com/msikma/pokesprite/raw/master/pokemon-gen8/shiny/{name}.png"
             )
             if img != None:
                 total += 1
                 colors = get_colors(img)
-                text = convert_to_text(colors)
-                savefile(name, text, shiny)
-            shiny = True
+                # Both sprites are cropped to the box of the regular one
+                swap = {}
+                if shiny_img != None:
+                    swap = shiny_colors(colors, get_colors(shiny_img, box=img.getbbox()))
+                save_icon(name, colors, swap)
 
         num = f"{'0' if n < 100 else ''}{'0' if n < 10 else ''}{n}"
         loading_bar(n, json_data.__len__(), flavour=f"- {num}. {name}" + " "*10)
 
-    if not os.path.exists(f"assets/icons/unknown.txt"):
+    if not os.path.exists(f"assets/icons/unknown.pki"):
         img = getImage(
             f"https://github.com/msikma/pokesprite/raw/master/pokemon-gen8/unknown.png"
         )
         if img != None:
             total += 1
             colors = get_colors(img, True)
-            text = convert_to_text(colors)
-            savefile("unknown", text, False)
+            save_icon("unknown", colors)
     else:
         total += 1
     loading_bar(n, json_data.__len__(), flavour=f"- 000. unknown" + " "*10)
 
-    print(f"\n[info] [{total}/{n*2 + 1}] pokémon icons loaded.")
+    print(f"\n[info] [{total}/{n + 1}] pokémon icons loaded.")
@@ -0,0 +1,91 @@
+import struct
+import sys
+import time
+
+import requests
+
+POKEAPI = "https://pokeapi.co/api/v2"
+
+# Types in the order of the PokéAPI IDs, must stay in sync with dex.c
+TYPES = [
+    "normal", "fighting", "flying", "poison", "ground", "rock",
+    "bug", "ghost", "steel", "fire", "water", "grass",
+    "electric", "psychic", "ice", "dragon", "dark", "fairy",
+]
+GENERATIONS = [
+    "generation-i", "generation-ii", "generation-iii", "generation-iv",
+    "generation-v", "generation-vi", "generation-vii", "generation-viii",
+    "generation-ix",
+]
+LEGENDARY = 1 << 0
+MYTHICAL = 1 << 1
+
+start = time.time()
+
+def loading_bar(iteration, total, length=30, flavour=""):
+    """
+    function that create loading bar in the console.
+    """
+    percent = iteration / total
+    bar = "━" * int(length * percent) + "-" * (length - int(length * percent))
+    timer = time.time() - start
+    sys.stdout.write(f"\r{timer:.2f}s - [{bar}] {percent * 100:.1f}% {flavour if flavour != '' else ' '*10}")
+    sys.stdout.flush()
+
+
+def get_json(url):
+    try:
+        response = requests.get(url)
+        response.raise_for_status()
+        return response.json()
+    except:
+        print(f"error trying to request from : {url}")
+        return None
+
+
+def get_entry(id):
+    """
+    Columns of a species: (types, generation, flags, stats)
+    """
+    types = [0xFF, 0xFF]
+    gen = 0
+    flags = 0
+    stats = [0] * 6
+
+    pokemon = get_json(f"{POKEAPI}/pokemon/{id}/")
+    if pokemon != None:
+        for slot in pokemon["types"][:2]:
+            types[slot["slot"] - 1] = TYPES.index(slot["type"]["name"])
+        for i, stat in enumerate(pokemon["stats"][:6]):
+            stats[i] = min(stat["base_stat"], 255)
+
+    species = get_json(f"{POKEAPI}/pokemon-species/{id}/")
+    if species != None:
+        gen = GENERATIONS.index(species["generation"]["name"]) + 1
+        if species["is_legendary"]:
+            flags |= LEGENDARY
+        if species["is_mythical"]:
+            flags |= MYTHICAL
+    return types, gen, flags, stats
+
+
+def savefile(entries):
+    """
+    Write the columns in assets/index.bin, see dex.c for the format
+    """
+    with open("assets/index.bin", "wb") as f:
+        f.write(b"PKDX" + struct.pack("<BBH", 1, 0, len(entries)))
+        f.write(bytes(t for entry in entries for t in entry[0]))
+        f.write(bytes(entry[1] for entry in entries))
+        f.write(bytes(entry[2] for entry in entries))
+        f.write(bytes(s for entry in entries for s in entry[3]))
+
+
+if __name__ == "__main__":
+    count = get_json(f"{POKEAPI}/pokemon-species/?limit=1")["count"]
+    entries = []
+    for id in range(1, count + 1):
+        entries.append(get_entry(id))
+        loading_bar(id, count, flavour=f"- {id:04}" + " "*10)
+    savefile(entries)
+    print(f"\n[info] [{count}] pokémons indexed.")
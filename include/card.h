@@ -0,0 +1,37 @@
+#ifndef CARD_H
+#define CARD_H
+
+#include <stdio.h>
+
+#include "pokefetch.h"
+
+/**
+ * @brief Parse the layout given to `--fields`.
+ *
+ * @param str Comma separated list of fields (e.g., "name,types,stats,desc"),
+ * the names are the ones of `Field` in lower case, "all" selects every field
+ * @param fields Where the fields are stored
+ * @return 0 if every field is valid, otherwise 1
+ */
+int parse_fields(const char *str, unsigned *fields);
+
+/**
+ * @brief Fetch and display the card of a pokémon.
+ *
+ * Only the data sources needed by the fields are used: the local data first,
+ * then the pokemon and pokemon-species endpoints if some fields are still
+ * missing. The documents are fetched as a graph of dependent requests: the
+ * card is displayed as soon as its documents are there, while the evolution
+ * chain and the species of its members are still being fetched. Icons are
+ * scaled down when the terminal is too small for them.
+ *
+ * @param ctx Context of the card
+ * @param options What to show on the card
+ * @param out Where the card is written
+ * @return 0 if the card was displayed, otherwise 1
+ *
+ * @see Scheduler
+ */
+int show_card(struct Pokefetch *ctx, struct CardOptions *options, FILE *out);
+
+#endif // !CARD_H
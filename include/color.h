@@ -0,0 +1,131 @@
+#ifndef COLOR_H
+#define COLOR_H
+
+#include <stddef.h>
+
+#include "pokefetch.h"
+
+/**
+ * @struct PaletteEntry
+ * @brief A color of an icon with its precomputed quantizations.
+ *
+ * The table of an icon is generated with the icon by `make icon` and stored
+ * in its `.pki` file (see icon.h), or next to a text icon in a `.pal` file,
+ * one entry per line: `r g b c256 c16`, followed by the same five values for
+ * the color of the shiny sprite. The shiny sprite is a palette swap of the
+ * regular one, so only the regular icon is stored.
+ */
+struct PaletteEntry {
+  unsigned char r, g, b; /**< 24-bit color as stored in the icon */
+  unsigned char c256;    /**< Nearest color in the xterm-256 palette */
+  unsigned char c16;     /**< Nearest color in the ANSI-16 palette */
+  unsigned char sr, sg, sb; /**< 24-bit color in the shiny sprite */
+  unsigned char sc256;   /**< Nearest xterm-256 color in the shiny sprite */
+  unsigned char sc16;    /**< Nearest ANSI-16 color in the shiny sprite */
+};
+
+/**
+ * @struct Palette
+ * @brief Quantization table of an icon.
+ *
+ * The entries are indexed by color in an open addressing hash table, built
+ * once when the table is loaded, so that each cell of the icon finds its
+ * entry without scanning the table.
+ */
+struct Palette {
+  struct PaletteEntry *entries; /**< Entries of the table */
+  int size;                     /**< Number of entries */
+  int *slots;   /**< Index + 1 of the entry of each slot, 0 if empty */
+  int nb_slots; /**< Number of slots, a power of two */
+};
+
+/**
+ * @brief Guess the color depth supported by the terminal.
+ *
+ * This function looks at `NO_COLOR`, `COLORTERM` and `TERM` in this order.
+ *
+ * @return The best color mode the terminal seems to support
+ */
+enum ColorMode detect_color_mode(void);
+
+/**
+ * @brief Parse the value given to `--colors`.
+ *
+ * @param str "256", "16", "none" or "true" (also "truecolor" and "24bit")
+ * @param mode Where the result is stored
+ * @return 0 if the string is a valid mode, otherwise 1
+ */
+int parse_color_mode(const char *str, enum ColorMode *mode);
+
+/**
+ * @brief Nearest xterm-256 color of a 24-bit color.
+ *
+ * @return An index between 16 and 255 (the 6x6x6 cube or the gray ramp)
+ */
+int rgb_to_256(int r, int g, int b);
+
+/**
+ * @brief Nearest ANSI-16 color of a 24-bit color.
+ *
+ * @return An index between 0 and 15
+ */
+int rgb_to_16(int r, int g, int b);
+
+/**
+ * @brief Write the escape sequence of a color in the given mode.
+ *
+ * @param buf Where the escape sequence is written
+ * @param len Size of the buffer
+ * @param mode Color depth of the terminal
+ * @param layer `FG` or `BG`
+ * @param rgb Color as defined in pokemon.h (e.g. `FIRE`)
+ * @return The length of the sequence, 0 in `COLOR_NONE` mode
+ */
+int format_color(char *buf, size_t len, enum ColorMode mode, const char *layer,
+                 const char *rgb);
+
+/**
+ * @brief Load the quantization table of an icon.
+ *
+ * @param filename Path to the `.pal` file of the icon
+ * @param palette Where the table and its index are stored, empty if the file
+ * does not exist
+ * @return 0 if the table was loaded, otherwise 1
+ */
+int load_palette(const char *filename, struct Palette *palette);
+
+/**
+ * @brief Free the entries of a quantization table and their index.
+ */
+void free_palette(struct Palette *palette);
+
+/**
+ * @brief Write the escape sequence of a color of an icon.
+ *
+ * @param buf Where the sequence is written, at least 20 bytes
+ * @param mode Color depth of the terminal
+ * @param bg 1 for a background color, 0 for a foreground one
+ * @param entry Color in the table of the icon
+ * @param shiny 1 for the color of the shiny sprite
+ * @return The length of the sequence, 0 in `COLOR_NONE` mode
+ */
+int format_entry(char *buf, enum ColorMode mode, int bg,
+                 const struct PaletteEntry *entry, int shiny);
+
+/**
+ * @brief Rewrite the 24-bit escape sequences of an icon for a color mode.
+ *
+ * Colors are looked up in the palette and only computed when missing from
+ * it. The shiny sprite is drawn by replacing each color by its shiny one.
+ *
+ * @param icon Text of the icon, as generated by `make icon`
+ * @param mode Color depth of the terminal
+ * @param palette Quantization table of the icon, may be empty
+ * @param shiny 1 to draw the shiny sprite, 0 for the regular one
+ * @return A dynamically allocated string with the icon, to free with
+ * `mem_free()`, or `NULL`
+ */
+char *color_icon(const char *icon, enum ColorMode mode,
+                 const struct Palette *palette, int shiny);
+
+#endif // !COLOR_H
@@ -0,0 +1,63 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "dex.h"
+#include "json.h"
+#include "pokefetch.h"
+
+#define CACHE_SIZE 256
+
+/**
+ * @struct CacheEntry
+ * @brief A response of the PokéAPI kept in the cache.
+ */
+struct CacheEntry {
+  char *url;  /**< URL of the response */
+  char *body; /**< Response */
+};
+
+/**
+ * @struct Pokefetch
+ * @brief Context of libpokefetch, see pokefetch.h.
+ */
+struct Pokefetch {
+  char *data_dir;                       /**< Directory of the local data */
+  char *api;                            /**< Base URL of the PokéAPI */
+  CURLSH *share;                        /**< DNS, TLS sessions and cookies */
+  pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST]; /**< Locks of `share` */
+  struct CacheEntry cache[CACHE_SIZE];  /**< Responses, oldest replaced first */
+  int cache_next;                       /**< Next entry to replace */
+  pthread_rwlock_t cache_lock;          /**< Lock of the cache */
+  struct JsonDoc local;                 /**< `pokemons.json`, read only */
+  struct DexIndex dex;                  /**< `index.bin`, read only */
+  _Atomic uint64_t rng;                 /**< State of the generator */
+};
+
+/**
+ * @brief Look for a response in the cache of the context.
+ *
+ * @return A dynamically allocated copy of the response, or `NULL` if missing
+ */
+char *cache_get(struct Pokefetch *ctx, const char *url);
+
+/**
+ * @brief Store a response in the cache of the context.
+ */
+void cache_put(struct Pokefetch *ctx, const char *url, const char *body);
+
+/**
+ * @brief Local data of the pokémons.
+ *
+ * The data is loaded with the context and then shared, read only, by every
+ * thread.
+ *
+ * @return The tape of `pokemons.json`, or `NULL` if not found
+ */
+const struct JsonDoc *local_pokemons(struct Pokefetch *ctx);
+
+#endif // !CONTEXT_H
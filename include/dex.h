@@ -0,0 +1,145 @@
+#ifndef DEX_H
+#define DEX_H
+
+#include <stdint.h>
+
+#include "pokefetch.h"
+
+#define DEX_NB_TYPES 18
+#define DEX_NB_GENERATIONS 9
+
+/**
+ * @struct DexIndex
+ * @brief Columnar index of every species, for filtered random selection.
+ *
+ * The index is generated by `make index` in `index.bin` of the data
+ * directory. Each column is an array over the species, the one of ID `id`
+ * being at `id - 1`, and each filterable value also has a bitset over the
+ * species, so that a filter is a few ANDs of bitsets.
+ */
+struct DexIndex {
+  int count;                            /**< Number of species */
+  int words;                            /**< 64-bit words of each bitset */
+  int has_types;                        /**< 0 if `index.bin` was missing */
+  uint8_t *types;                       /**< Two types per species, 0xFF if none */
+  uint8_t *gens;                        /**< Generation of each species */
+  uint8_t *flags;                       /**< DEX_LEGENDARY and DEX_MYTHICAL */
+  uint8_t *stats;                       /**< Six base stats per species */
+  uint64_t *all;                        /**< Every species */
+  uint64_t *type_sets[DEX_NB_TYPES];    /**< Species of each type */
+  uint64_t *gen_sets[DEX_NB_GENERATIONS]; /**< Species of each generation */
+  uint64_t *legendary;                  /**< Legendary species */
+  uint64_t *mythical;                   /**< Mythical species */
+  void *block;                          /**< Allocation holding everything */
+};
+
+#define DEX_LEGENDARY (1 << 0)
+#define DEX_MYTHICAL (1 << 1)
+
+/**
+ * @struct DexRow
+ * @brief Columns of a single species, as written by `dex_write()`.
+ */
+struct DexRow {
+  uint8_t types[2]; /**< Types of the species, 0xFF if none */
+  uint8_t gen;      /**< Generation of the species */
+  uint8_t flags;    /**< DEX_LEGENDARY and DEX_MYTHICAL */
+  uint8_t stats[6]; /**< Base stats of the species */
+};
+
+/**
+ * @brief Load the index of the species.
+ *
+ * When `index.bin` is missing, the index only knows the generations, from
+ * the ID ranges of each generation and the number of local species.
+ *
+ * @param index Where the index is stored
+ * @param data_dir Directory of the local data
+ * @param count Number of species of the local data, for the fallback
+ * @return 0 if the index was loaded, otherwise 1
+ */
+int dex_load(struct DexIndex *index, const char *data_dir, int count);
+
+/**
+ * @brief Free the index of the species.
+ */
+void dex_free(struct DexIndex *index);
+
+/**
+ * @brief Columns of a species of the index.
+ *
+ * @param id ID of the species, between 1 and `index->count`
+ * @param row Where the columns are stored
+ */
+void dex_row(const struct DexIndex *index, int id, struct DexRow *row);
+
+/**
+ * @brief Write an index of the species, as `make index` does.
+ *
+ * @param path Path to the `index.bin` file
+ * @param rows Columns of every species, the one of ID `id` at `id - 1`
+ * @param count Number of species
+ * @return 0 if the index was written, otherwise 1
+ */
+int dex_write(const char *path, const struct DexRow *rows, int count);
+
+/**
+ * @brief Index of a type from its name in english.
+ *
+ * @return The index, between 0 and DEX_NB_TYPES - 1, or -1 if unknown
+ */
+int dex_type(const char *name);
+
+/**
+ * @brief Name of a type in english.
+ *
+ * @return The name (e.g., "fire"), or `NULL` if the index is invalid
+ */
+const char *dex_type_name(int type);
+
+/**
+ * @brief Generation from its name in the PokéAPI.
+ *
+ * @param name Name of the generation (e.g., "generation-iv")
+ * @return The generation, between 1 and DEX_NB_GENERATIONS, or 0 if unknown
+ */
+int dex_generation(const char *name);
+
+/**
+ * @brief Parse the generations given to `--gen`.
+ *
+ * @param str A generation ("2"), a range ("1-3") or a list of both ("1,4-5")
+ * @param gens Where the generations are added, bit 0 being generation 1
+ * @return 0 if the string is valid, otherwise 1
+ */
+int dex_parse_gens(const char *str, uint16_t *gens);
+
+/**
+ * @brief Number of species matching a filter.
+ */
+int dex_count(const struct DexIndex *index, const struct DexFilter *filter);
+
+/**
+ * @brief Pick a species matching a filter.
+ *
+ * @param index Index of the species
+ * @param filter Filter of the selection
+ * @param random Random number, the pick is uniform when it is
+ * @return The ID of the species, or 0 if none matches
+ */
+int dex_pick(const struct DexIndex *index, const struct DexFilter *filter,
+             uint64_t random);
+
+/**
+ * @brief Every species matching a filter.
+ *
+ * @param index Index of the species
+ * @param filter Filter of the selection
+ * @param ids Where the IDs are stored, in increasing order
+ * @param max Size of `ids`
+ * @return The number of IDs stored
+ */
+int dex_select(const struct DexIndex *index, const struct DexFilter *filter,
+               int *ids, int max);
+
+#endif // !DEX_H
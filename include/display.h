@@ -1,17 +1,57 @@
 #ifndef DISPLAY
 #define DISPLAY
 
+#include <stdio.h>
+
+#include "color.h"
+
+struct Pokemon;
+struct Evolution;
+
 /**
  * @brief Function that display information about a pokémon.
  *
  * This function displays information about the given pokemon, it takes ASCII sprite of the
  * pokemon in 'assets/icons/' and displays it on the left and its infomation in the right.
  *
+ * @param out Where the card is written
  * @param pokemon struct Pokemon where are the information about him
  * @param shiny char representing "shiny" if the pokemon is shiny, otherwise "regular"
+ * @param mode Color depth used for the icon and the text
+ * @param fields Fields to display, see `Field`
+ * @return returns 0 if everything went fine, otherwise 1
+ */
+int display(FILE *out, struct Pokemon *pokemon, char *shiny,
+            enum ColorMode mode, unsigned fields);
+
+/**
+ * @brief Function that display the evolution line of a pokémon.
+ *
+ * This function displays the icons of the members of the line side by side,
+ * then their names grouped by stage (e.g. "Pichu > Pikachu > Raichu").
+ *
+ * @param out Where the line is written
+ * @param members Members of the evolution line
+ * @param size Number of members
+ * @param current ID of the pokémon of the card, highlighted in the line
+ * @param mode Color depth used for the icons and the text
  * @return returns 0 if everything went fine, otherwise 1
  */
-int display(struct Pokemon *pokemon, char *shiny);
+int display_evolutions(FILE *out, struct Evolution *members, int size,
+                       int current, enum ColorMode mode);
+
+/**
+ * @brief Size of the terminal an output is written to.
+ *
+ * The size is asked to the terminal itself (`TIOCGWINSZ`), then to the shell
+ * through `COLUMNS` and `LINES` when the output is not a terminal.
+ *
+ * @param fd File descriptor of the output (e.g., `STDOUT_FILENO`)
+ * @param columns Where the number of columns is stored, 0 if unknown
+ * @param rows Where the number of rows is stored, 0 if unknown
+ * @return 0 if the size is known, otherwise 1
+ */
+int terminal_size(int fd, int *columns, int *rows);
 
 #endif // !DISPLAY
 #define DISPLAY
@@ -0,0 +1,38 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdio.h>
+
+#include "pokefetch.h"
+
+/**
+ * @brief Display the icons of many pokémons in a grid.
+ *
+ * The icons are tiled across the width of the terminal, each one with a
+ * caption giving its ID and name. Every icon is indexed once (offset and
+ * width of each of its lines), then the rows of the grid are composed side
+ * by side in a single buffer, sized beforehand, which is written at once.
+ * Icons wider than the terminal are drawn at a smaller scale. Only the local
+ * data is used, nothing is fetched.
+ *
+ * @param ctx Context of the gallery
+ * @param ids IDs of the pokémons, in the order of the gallery
+ * @param nb_ids Number of pokémons
+ * @param options How to show the gallery
+ * @param out Where the gallery is written
+ * @return 0 if the gallery was displayed, otherwise 1
+ */
+int show_grid(struct Pokefetch *ctx, const int *ids, int nb_ids,
+              struct GridOptions *options, FILE *out);
+
+/**
+ * @brief Parse the team given to `--team`.
+ *
+ * @param str Comma separated list of IDs (e.g., "25,6,150")
+ * @param ids Where the IDs are stored
+ * @param max Size of `ids`
+ * @return The number of IDs, or -1 if the list is invalid
+ */
+int parse_team(const char *str, int *ids, int max);
+
+#endif // !GRID_H
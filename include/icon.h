@@ -0,0 +1,76 @@
+#ifndef ICON_H
+#define ICON_H
+
+#include <stddef.h>
+
+#include "color.h"
+
+/**
+ * @file icon.h
+ * @brief Binary icons, the `.pki` files generated by `make icon`.
+ *
+ * An icon is a grid of cells, each cell being two pixels drawn with a
+ * half block: the top one in the foreground and the bottom one in the
+ * background. Little endian layout of the file:
+ *
+ * | Offset | Size       | Content                                      |
+ * |--------|------------|----------------------------------------------|
+ * | 0      | 4          | Magic, "PKI" then the version (1)            |
+ * | 4      | 2          | Width, in cells, at least 1                  |
+ * | 6      | 2          | Height, in cells of two pixels, at least 1   |
+ * | 8      | 1          | Number of colors `n`, at most 255            |
+ * | 9      | 1          | Reserved, 0                                  |
+ * | 10     | 10 * n     | Palette, see `PaletteEntry` (same order)     |
+ * | ...    | 3 per run  | Runs of cells: count, top index, bottom one  |
+ *
+ * Index 0 is a transparent pixel and index `i` the color `i - 1` of the
+ * palette. A run repeats the same cell `count` times (1 to 255), runs go on
+ * from one line to the next until `width * height` cells.
+ *
+ * Every icon is also stored at half and quarter scale, downscaled with a box
+ * filter by `make icon`, in `icons/half` and `icons/quarter` next to
+ * `icons/regular`. Small terminals use them instead of resampling the icon.
+ */
+
+#define ICON_MAGIC "PKI\001"
+#define ICON_HEADER_SIZE 10
+#define ICON_ENTRY_SIZE 10
+
+/**
+ * @brief Decode a binary icon into the text of the icon.
+ *
+ * The escape sequences of the palette are formatted once, then every cell
+ * is copied from them into a buffer sized for the worst case.
+ *
+ * @param data Content of the `.pki` file
+ * @param size Size of the content
+ * @param mode Color depth of the terminal
+ * @param shiny 1 to draw the shiny sprite, 0 for the regular one
+ * @return A dynamically allocated string with the icon, or `NULL` if the
+ * icon is invalid
+ */
+char *decode_icon(const unsigned char *data, size_t size, enum ColorMode mode,
+                  int shiny);
+
+/**
+ * @brief Read the size of a binary icon, from its header only.
+ *
+ * @param filename Path to the `.pki` file
+ * @param width Where the width is stored, in cells
+ * @param height Where the height is stored, in cells
+ * @return 0 if the header was read, otherwise 1
+ */
+int read_icon_size(const char *filename, int *width, int *height);
+
+/**
+ * @brief Read and decode a binary icon.
+ *
+ * @param filename Path to the `.pki` file
+ * @param mode Color depth of the terminal
+ * @param shiny 1 to draw the shiny sprite, 0 for the regular one
+ * @return A dynamically allocated string with the icon, or `NULL` if the
+ * file is missing or invalid
+ */
+char *load_packed_icon(const char *filename, enum ColorMode mode, int shiny);
+
+#endif // !ICON_H
@@ -0,0 +1,215 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_MAX_DEPTH 64
+
+/**
+ * @enum JsonType
+ * @brief Type of a JSON value.
+ */
+enum JsonType {
+  JSON_NULL,
+  JSON_FALSE,
+  JSON_TRUE,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+};
+
+/**
+ * @struct JsonToken
+ * @brief A value of a document, in the order of the text.
+ *
+ * The members of an object are a key (a string token) followed by its value,
+ * and every container is followed by its children, so a whole document is a
+ * flat array of tokens: the tape. `next` skips a value with its children.
+ */
+struct JsonToken {
+  uint32_t start;   /**< Offset of the value, after the quote for strings */
+  uint32_t len;     /**< Length of the value, without the quotes */
+  uint32_t next;    /**< Index of the token after the value */
+  uint8_t type;     /**< Type of the value, see `JsonType` */
+  uint8_t escaped;  /**< 1 if the string holds escape sequences */
+};
+
+/**
+ * @struct JsonDoc
+ * @brief A document tokenized in place.
+ *
+ * Lookups never copy the text: strings are views into it, and their escape
+ * sequences are only decoded when asked for. The text must outlive the
+ * document.
+ */
+struct JsonDoc {
+  const char *text;          /**< Text of the document, not owned */
+  size_t size;               /**< Size of the text */
+  struct JsonToken *tokens;  /**< Tape of the document */
+  int nb_tokens;             /**< Number of tokens */
+  void *map;                 /**< Mapping of the file, see `json_load()` */
+  int temp;                  /**< 1 if the tape is the one of the thread */
+};
+
+/**
+ * @struct JsonView
+ * @brief A string of a document, escape sequences included.
+ */
+struct JsonView {
+  const char *ptr; /**< Start of the string in the text */
+  size_t len;      /**< Length of the string */
+};
+
+/**
+ * @brief Tokenize a text.
+ *
+ * Nothing is allocated: the tokens go in the array given, and the ones that
+ * do not fit are only counted, like the characters of `snprintf()`.
+ *
+ * @param text Text of the document, not necessarily NUL terminated
+ * @param size Size of the text
+ * @param tokens Where the tokens are stored, may be `NULL` if `max` is 0
+ * @param max Size of `tokens`
+ * @return The number of tokens of the whole text, which may be more than
+ * `max`, or -1 if the text is invalid
+ */
+int json_tokenize(const char *text, size_t size, struct JsonToken *tokens,
+                  int max);
+
+/**
+ * @brief Tokenize a text into a document.
+ *
+ * The tape is the only allocation, the text is neither copied nor modified.
+ *
+ * @return 0 if the text was tokenized, otherwise 1
+ */
+int json_parse(struct JsonDoc *doc, const char *text, size_t size);
+
+/**
+ * @brief Tokenize a text into the tape of the calling thread.
+ *
+ * The tape of a thread grows to the largest document it parsed and is kept
+ * for the next ones, so parsing allocates nothing once it has seen the
+ * largest document. Only one such document per thread uses the tape: until
+ * it is freed, the next ones get a tape of their own, as `json_parse()`. The
+ * document must be freed by the thread that parsed it.
+ *
+ * @return 0 if the text was tokenized, otherwise 1
+ */
+int json_parse_temp(struct JsonDoc *doc, const char *text, size_t size);
+
+/**
+ * @brief Free the tape of the calling thread, see `json_parse_temp()`.
+ *
+ * The tapes of the other threads are freed when they exit. Nothing is freed
+ * while a document uses the tape.
+ */
+void json_release(void);
+
+/**
+ * @brief Map a file and tokenize it into a document.
+ *
+ * @return 0 if the file was tokenized, otherwise 1
+ */
+int json_load(struct JsonDoc *doc, const char *filename);
+
+/**
+ * @brief Map a file and tokenize it into the tape of the calling thread,
+ * see `json_parse_temp()`.
+ *
+ * @return 0 if the file was tokenized, otherwise 1
+ */
+int json_load_temp(struct JsonDoc *doc, const char *filename);
+
+/**
+ * @brief Free the tape of a document, and its mapping if any.
+ */
+void json_free(struct JsonDoc *doc);
+
+/**
+ * @brief Type of a token.
+ *
+ * @return The type, or `JSON_NULL` if the token is -1
+ */
+enum JsonType json_type(const struct JsonDoc *doc, int token);
+
+/**
+ * @brief Value of a member of an object.
+ *
+ * @param doc Document of the object
+ * @param object Token of the object
+ * @param key Name of the member, without escape sequences
+ * @return The token of the value, or -1 if missing
+ */
+int json_get(const struct JsonDoc *doc, int object, const char *key);
+
+/**
+ * @brief First child of an array, or first key of an object.
+ *
+ * @return The token of the child, or -1 if empty
+ */
+int json_first(const struct JsonDoc *doc, int container);
+
+/**
+ * @brief Next child of an array, or next key of an object.
+ *
+ * @param doc Document of the container
+ * @param container Token of the container
+ * @param child Token of the current child (of the current key for objects)
+ * @return The token of the next child, or -1 after the last one
+ */
+int json_next(const struct JsonDoc *doc, int container, int child);
+
+/**
+ * @brief Item of an array.
+ *
+ * @return The token of the item, or -1 if out of bounds
+ */
+int json_item(const struct JsonDoc *doc, int array, int index);
+
+/**
+ * @brief Number of children of an array or an object.
+ */
+int json_size(const struct JsonDoc *doc, int container);
+
+/**
+ * @brief Raw view of a string, escape sequences included.
+ *
+ * @return The view, empty if the token is not a string
+ */
+struct JsonView json_view(const struct JsonDoc *doc, int token);
+
+/**
+ * @brief Compare a string to a text without escape sequences.
+ *
+ * @return 1 if they are equal, otherwise 0
+ */
+int json_equals(const struct JsonDoc *doc, int token, const char *str);
+
+/**
+ * @brief Value of a number, truncated to an integer.
+ *
+ * @return The value, 0 if the token is not a number
+ */
+long json_int(const struct JsonDoc *doc, int token);
+
+/**
+ * @brief Decode a string in a buffer.
+ *
+ * @param buf Where the string is written, NUL terminated
+ * @param size Size of the buffer, the string is truncated to fit
+ * @return The length of the whole decoded string
+ */
+size_t json_decode(const struct JsonDoc *doc, int token, char *buf,
+                   size_t size);
+
+/**
+ * @brief Decode a string in a dynamically allocated buffer.
+ *
+ * @return The string, or `NULL` if the token is not a string
+ */
+char *json_strdup(const struct JsonDoc *doc, int token);
+
+#endif // !JSON_H
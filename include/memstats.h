@@ -0,0 +1,69 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @enum MemPhase
+ * @brief Phases the allocations are accounted to, see `--mem-stats`.
+ */
+enum MemPhase {
+  MEM_SETUP,  /**< Everything else: context, local data, index */
+  MEM_FETCH,  /**< Requests and their responses */
+  MEM_PARSE,  /**< JSON documents and the fields taken from them */
+  MEM_ICON,   /**< Loading and coloring the icons */
+  MEM_RENDER, /**< Composing the output */
+  NB_MEM_PHASES
+};
+
+/*
+ * Allocator used by libpokefetch and curl. These are the functions of
+ * the C library until `mem_stats_enable()` swaps them for counting ones, so
+ * the accounting costs nothing when it is off. Memory they return must be
+ * freed with `mem_free()`, a `free()` would be reported as still allocated.
+ * Strings returned by the API are freed with `pokefetch_free_string()`.
+ */
+extern void *(*mem_malloc)(size_t size);
+extern void *(*mem_calloc)(size_t nmemb, size_t size);
+extern void *(*mem_realloc)(void *ptr, size_t size);
+extern void (*mem_free)(void *ptr);
+
+/**
+ * @brief `strdup()` allocating with `mem_malloc()`.
+ */
+char *mem_strdup(const char *str);
+
+/**
+ * @brief Count every allocation from now on.
+ *
+ * Must be called before the first allocation of the library and of curl,
+ * and before any thread is started, i.e. before `pokefetch_new()`.
+ */
+void mem_stats_enable(void);
+
+/**
+ * @brief Check whether the allocations are counted.
+ */
+int mem_stats_enabled(void);
+
+/**
+ * @brief Account the allocations of the calling thread to a phase.
+ *
+ * Phases nest: the previous one is restored with a second call.
+ *
+ * @param phase Phase starting
+ * @return The phase of the thread until now
+ */
+enum MemPhase mem_phase(enum MemPhase phase);
+
+/**
+ * @brief Write the allocation count, the bytes allocated, the peak heap and
+ * the peak resident set size of each phase.
+ *
+ * The heap is the memory allocated through the hooks, the resident set size
+ * is sampled when a phase ends.
+ */
+void mem_stats_report(FILE *out);
+
+#endif // !MEMSTATS_H
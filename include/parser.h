@@ -6,6 +6,21 @@
 #include <string.h>
 #include <curl/curl.h>
 
+#include "color.h"
+
+struct Pokefetch;
+
+/**
+ * @struct Memory
+ * @brief A structure representing a memory space.
+ *
+ * This structure is used to store response from a HTTP request.
+ */
+struct Memory {
+  char *response; /**< Response to save in the memory */
+  size_t size;    /**< Size of the response */
+};
+
 /**
  * @brief Callback function for handling HTTP response data.
  *
@@ -24,17 +39,20 @@ size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp);
  * @brief Function used for fetching from a HTTP response data.
  *
  * This function sends an HTTP GET request to the PokéAPI to retrieve Pokémon
- * data in JSON format based on the given Pokémon ID.
+ * data in JSON format based on the given Pokémon ID. The response comes from
+ * the cache of the context when possible, and the request shares the DNS
+ * cache, TLS sessions and cookies of the context.
  *
- * @param id ID of the pokémon to fetch (e.g., 25 for Pikachu)
+ * @param ctx Context of the request
  * @param data Where the data is fetched in the PokéAPI (e.g., 'pokemon' for
  * basic information)
+ * @param id ID of the pokémon to fetch (e.g., 25 for Pikachu), 0 for the list
  * @return A dynamically allocated string containing the API response (JSON
  * format), or `NULL` if the request fails
  *
  * @see write_callback()
  */
-char *fetch_pokemon(const char *link, const char *data, int id);
+char *fetch_pokemon(struct Pokefetch *ctx, const char *data, int id);
 
 /**
  * @brief Retrieve the total number of pokémon in PokéAPI.
@@ -45,45 +63,79 @@ char *fetch_pokemon(const char *link, const char *data, int id);
  * If the JSON parsing fails or the "count" field is not found or is not a
  * number, the function will return `0`.
  *
+ * @param ctx Context of the request
  * @return The number of Pokémon as an integer. If an error occurs or the
  * "count" field is missing or invalid, it returns `0`
  *
  * @see fetch_pokemon()
  */
-int pokemon_count(void);
+int pokemon_count(struct Pokefetch *ctx);
 
 /**
  * @brief Function that translate types.
  * 
  * This function translates an array of string representing a type each into another language.
  *
+ * @param data_dir Directory of the local data
  * @param types Array of twe string representing types
  * @param lang Language of the translation
  */
-void convert_types(char *types[2], char *lang);
+void convert_types(const char *data_dir, char *types[2], char *lang);
 
 /**
- * @brief Parse the pokemon from two JSON data.
+ * @brief Parse the pokemon endpoint of a pokémon.
  *
- * This function creates a typedef Pokemon structure that stores all of its
- * information including: name, id, types, height, weight, description and
- * genus.
+ * This function fills the typedef Pokemon with the information of the
+ * pokemon endpoint: alias, id, and among types, height, weight, stats and
+ * abilities only the ones asked for.
  *
- * @param shiny char * "shiny" if shiny, "normal" otherwise
  * @param json_str JSON data as a string where we can find the name, id, types,
  * height and weight
+ * @param fields Fields of the card, see `Field`
+ *
+ * @return 0 if the data was parsed, otherwise 1
+ *
+ * @see Pokemon
+ */
+int parse_pokemon_json(struct Pokemon *pokemon, const char *json_str,
+    unsigned fields);
+
+/**
+ * @brief Parse the pokemon-species endpoint of a pokémon.
+ *
+ * This function fills the typedef Pokemon with the information of the
+ * pokemon-species endpoint asked for: name, description and genus. The name
+ * and the genus are skipped when the local data already gave them.
+ *
  * @param json_spe_str JSON data as a string where we can find the description
  * and the genus
  * @param version Version of the description (e.g., "omega-ruby" by default)
  * @param lang Language of the description and genus (e.g., "fr" by default)
+ * @param fields Fields of the card, see `Field`
  *
- * @return A typedef Pokemon that contains information about it, with "Not
- * Found" or 0 as the result for each not found information
+ * @return 0 if the data was parsed, otherwise 1
  *
  * @see Pokemon
  */
-int parse_pokemon_json(struct Pokemon *pokemon, const char *shiny,
-    const char *json_str, const char *json_spe_str, char *version, char *lang);
+int parse_species_json(struct Pokemon *pokemon, const char *json_spe_str,
+    char *version, char *lang, unsigned fields);
+
+/**
+ * @brief Fill a pokémon with the local data.
+ *
+ * `pokemons.json` holds the name and the genus of every pokémon in a few
+ * languages, which is enough for a card without any request. The alias is
+ * derived from the english name.
+ *
+ * @param ctx Context holding the local data
+ * @param id ID of the pokémon
+ * @param lang Language of the name and the genus
+ * @param fields Fields of the card, see `Field`
+ *
+ * @return 0 if every field asked for was found, otherwise 1
+ */
+int parse_local_pokemon(struct Pokefetch *ctx, struct Pokemon *pokemon, int id,
+    char *lang, unsigned fields);
 
 /**
  * @brief Get the image as pixelart of the pokemon
@@ -99,6 +151,92 @@ int parse_pokemon_json(struct Pokemon *pokemon, const char *shiny,
  */
 int fetch_icon(char *filename, char *buf, int len);
 
+/**
+ * @brief Retrieve the URL of the evolution chain of a pokémon.
+ *
+ * @param json_spe_str JSON data of the pokemon-species endpoint
+ * @return A dynamically allocated string with the URL, or `NULL` if not found
+ */
+char *get_evolution_chain(const char *json_spe_str);
+
+/**
+ * @brief Parse the members of an evolution chain.
+ *
+ * The chain is flattened depth first, so each evolution comes right after
+ * the pokémon it evolves from. The name of each member is set to its english
+ * name until its species is parsed with `parse_species_name()`.
+ *
+ * @param json_str JSON data of the evolution-chain endpoint
+ * @param members Array where the members are stored
+ * @param max Size of the array
+ * @return The number of members, 0 if the parsing failed
+ */
+int parse_evolution_chain(const char *json_str, struct Evolution *members,
+    int max);
+
+/**
+ * @brief Retrieve the name of a pokémon from its species.
+ *
+ * @param json_spe_str JSON data of the pokemon-species endpoint
+ * @param lang Language of the name (e.g., "fr")
+ * @return A dynamically allocated string, or "Not Found"
+ */
+char *parse_species_name(const char *json_spe_str, char *lang);
+
+/**
+ * @brief Free the members of an evolution chain.
+ *
+ * @param members Array of members to free
+ * @param size Number of members
+ */
+void free_evolutions(struct Evolution *members, int size);
+
+/**
+ * @brief Name of the icon of a pokémon from its english name.
+ *
+ * This is the same transformation as the one used by `make icon`.
+ *
+ * @param name Name of the pokémon in english (e.g., "Mr. Mime")
+ * @return A dynamically allocated string (e.g., "mr-mime"), or "Not Found"
+ */
+char *icon_alias(const char *name);
+
+/**
+ * @brief Load the icon of a pokémon.
+ *
+ * The icon of an unknown pokémon is used when the icon is missing. Only the
+ * regular sprite is stored, see `load_colored_icon()` for the shiny one.
+ *
+ * @param data_dir Directory of the local data
+ * @param alias Name of the pokémon in english
+ * @return A dynamically allocated string with the icon, or "Not Found"
+ *
+ * @see fetch_icon()
+ */
+char *load_icon(const char *data_dir, const char *alias);
+
+/**
+ * @brief Load the icon of a pokémon in a color depth.
+ *
+ * The shiny sprite is drawn from the regular one by swapping its colors with
+ * the shiny ones of its palette. The icon is scaled down to the half or the
+ * quarter of its size when it does not fit in the space given, see icon.h.
+ *
+ * @param data_dir Directory of the local data
+ * @param shiny "shiny" or "regular"
+ * @param alias Name of the pokémon in english
+ * @param mode Color depth of the terminal
+ * @param max_width Width available for the icon, in columns, 0 for no limit
+ * @param max_height Height available for the icon, in lines, 0 for no limit
+ * @return A dynamically allocated string with the icon, or "Not Found"
+ *
+ * @see load_icon()
+ * @see color_icon()
+ */
+char *load_colored_icon(const char *data_dir, const char *shiny,
+                        const char *alias, enum ColorMode mode, int max_width,
+                        int max_height);
+
 /**
  * @brief Free the pokemon struct type
  *
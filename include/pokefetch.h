@@ -0,0 +1,245 @@
+#ifndef POKEFETCH_H
+#define POKEFETCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Public API of libpokefetch: the options of its entry points and the
+ * pokefetch_* functions. The other headers of include/ are internal to the
+ * library, whose other symbols are hidden, see the Makefile.
+ */
+
+/**
+ * @enum ColorMode
+ * @brief Color depth used when writing escape sequences to the terminal.
+ */
+enum ColorMode {
+  COLOR_NONE, /**< No color at all, only the glyphs are printed */
+  COLOR_16,   /**< The 16 ANSI colors (e.g. `31`, `97`) */
+  COLOR_256,  /**< The xterm-256 palette (e.g. `38;5;196`) */
+  COLOR_TRUE  /**< 24-bit colors (e.g. `38;2;230;40;40`) */
+};
+
+/**
+ * @enum Field
+ * @brief Fields that can be shown on a card, see `--fields`.
+ *
+ * Each field needs some of the data sources: the local data in `assets/`,
+ * the pokemon endpoint or the pokemon-species endpoint. Only the sources of
+ * the fields asked for are fetched and parsed.
+ */
+enum Field {
+  FIELD_NAME = 1 << 0,       /**< Name, local or pokemon-species */
+  FIELD_GENUS = 1 << 1,      /**< Genus, local or pokemon-species */
+  FIELD_TYPES = 1 << 2,      /**< Types, pokemon */
+  FIELD_HEIGHT = 1 << 3,     /**< Height, pokemon */
+  FIELD_WEIGHT = 1 << 4,     /**< Weight, pokemon */
+  FIELD_DESC = 1 << 5,       /**< Description, pokemon-species */
+  FIELD_STATS = 1 << 6,      /**< Base stats, pokemon */
+  FIELD_ABILITIES = 1 << 7,  /**< Abilities, pokemon */
+  FIELD_ICON = 1 << 8,       /**< Icon, local */
+  FIELD_EVOLUTIONS = 1 << 9  /**< Evolution line, pokemon-species */
+};
+
+#define DEFAULT_FIELDS (FIELD_NAME | FIELD_GENUS | FIELD_TYPES | FIELD_ICON)
+
+/**
+ * @struct CardOptions
+ * @brief What to show on the card and how.
+ */
+struct CardOptions {
+  int id;              /**< ID of the pokémon */
+  char *shiny;         /**< "shiny" or "regular" */
+  char *version;       /**< Version of the description (e.g., "omega-ruby") */
+  char *lang;          /**< Language of the text (e.g., "fr") */
+  enum ColorMode mode; /**< Color depth of the terminal */
+  unsigned fields;     /**< Fields shown on the card, see `Field` */
+  int columns;         /**< Width of the terminal, 0 if unknown */
+  int rows;            /**< Height of the terminal, 0 if unknown */
+};
+
+/**
+ * @struct DexFilter
+ * @brief Filter of the random selection, an empty filter selects everything.
+ */
+struct DexFilter {
+  uint32_t types;     /**< Types the species must all have (bit = type) */
+  uint16_t gens;      /**< Accepted generations (bit 0 = gen 1), 0 for all */
+  int legendary;      /**< 1 to keep legendary species */
+  int mythical;       /**< 1 to keep mythical species, both flags keep either */
+};
+
+/**
+ * @struct GridOptions
+ * @brief How to show a gallery of icons.
+ */
+struct GridOptions {
+  char *shiny;         /**< "shiny" or "regular" */
+  char *lang;          /**< Language of the captions (e.g., "fr") */
+  enum ColorMode mode; /**< Color depth of the terminal */
+  int width;           /**< Width of the terminal, in columns */
+};
+
+/**
+ * @struct WatchOptions
+ * @brief How to cycle through random pokémons.
+ */
+struct WatchOptions {
+  struct CardOptions card;  /**< Options of every card, the ID is random */
+  struct DexFilter filter;  /**< Filter of the random pokémons */
+  int shiny_rate;           /**< One card out of `shiny_rate` is shiny */
+  long interval;            /**< Time each card stays on screen, in ms */
+  int prefetch;             /**< Cards rendered ahead, 1 to 3 */
+};
+
+// Only the functions declared from here on are exported
+#pragma GCC visibility push(default)
+
+/**
+ * @struct Pokefetch
+ * @brief Context of libpokefetch.
+ *
+ * The context holds everything the cards need: the DNS cache, TLS sessions and
+ * cookies shared by the requests to the PokéAPI, the cache of its responses,
+ * the local data and the random number generator. Connections are not shared,
+ * each request or scheduler opens its own. A context can be shared by many
+ * threads rendering cards at the same time.
+ */
+struct Pokefetch;
+
+/**
+ * @brief Create a context.
+ *
+ * @param data_dir Directory of the local data (e.g., "assets"), `NULL` for
+ * the default one
+ * @param api Base URL of the PokéAPI, `NULL` for the default one
+ * @return The context, or `NULL` if the allocation failed
+ */
+struct Pokefetch *pokefetch_new(const char *data_dir, const char *api);
+
+/**
+ * @brief Free a context.
+ *
+ * No card may be rendering with the context anymore.
+ */
+void pokefetch_free(struct Pokefetch *ctx);
+
+/**
+ * @brief Seed the random number generator of the context.
+ */
+void pokefetch_seed(struct Pokefetch *ctx, unsigned long long seed);
+
+/**
+ * @brief Random integer between `min` and `max` included.
+ */
+int pokefetch_random(struct Pokefetch *ctx, int min, int max);
+
+/**
+ * @brief ID of a random pokémon matching a filter.
+ *
+ * The selection is done on the index of the species (`index.bin`), every
+ * matching pokémon having the same chance to be picked.
+ *
+ * @param ctx Context of the selection
+ * @param filter Types, generations and rarity of the pokémon
+ * @return The ID of the pokémon, or 0 if none matches
+ */
+int pokefetch_random_id(struct Pokefetch *ctx, const struct DexFilter *filter);
+
+/**
+ * @brief Every pokémon matching a filter.
+ *
+ * @param ctx Context of the selection
+ * @param filter Types, generations and rarity of the pokémons
+ * @param ids Where the IDs are stored, in increasing order
+ * @param max Size of `ids`
+ * @return The number of IDs stored
+ */
+int pokefetch_select(struct Pokefetch *ctx, const struct DexFilter *filter,
+                     int *ids, int max);
+
+/**
+ * @brief Check whether the index of the species knows the types and rarity.
+ *
+ * @return 1 if `index.bin` was loaded, 0 if only the generations are known
+ */
+int pokefetch_indexed(struct Pokefetch *ctx);
+
+/**
+ * @brief Number of pokémons, from the local data or else the PokéAPI.
+ *
+ * @return The number of pokémons, 0 if it could not be found
+ */
+int pokefetch_count(struct Pokefetch *ctx);
+
+/**
+ * @brief Render the card of a pokémon.
+ *
+ * @param ctx Context of the card
+ * @param options What to show on the card
+ * @param out Where the card is written
+ * @return 0 if the card was rendered, otherwise 1
+ */
+int pokefetch_render(struct Pokefetch *ctx, struct CardOptions *options,
+                     FILE *out);
+
+/**
+ * @brief Render the card of a pokémon in a string.
+ *
+ * @param ctx Context of the card
+ * @param options What to show on the card
+ * @return A dynamically allocated string, to free with
+ * `pokefetch_free_string()`, or `NULL` if the card failed
+ */
+char *pokefetch_render_string(struct Pokefetch *ctx,
+                              struct CardOptions *options);
+
+/**
+ * @brief Free a string returned by the library.
+ *
+ * @param str String to free, may be `NULL`
+ */
+void pokefetch_free_string(char *str);
+
+/**
+ * @brief Render the icons of many pokémons in a grid.
+ *
+ * @param ctx Context of the gallery
+ * @param ids IDs of the pokémons
+ * @param nb_ids Number of pokémons
+ * @param options How to show the gallery
+ * @param out Where the gallery is written
+ * @return 0 if the gallery was rendered, otherwise 1
+ */
+int pokefetch_render_grid(struct Pokefetch *ctx, const int *ids, int nb_ids,
+                          struct GridOptions *options, FILE *out);
+
+/**
+ * @brief Cycle through random pokémons until SIGINT or SIGTERM.
+ *
+ * A resize of the terminal (SIGWINCH) redraws the card. Not reentrant: the
+ * handlers of SIGINT, SIGTERM and SIGWINCH are process-wide, so a single
+ * slideshow may run at a time in the process, whatever the context. A second
+ * call while one runs fails.
+ *
+ * @param ctx Context of the cards
+ * @param options How to cycle
+ * @param out Terminal where the cards are shown
+ * @return 0 once interrupted, 1 if the slideshow could not start
+ */
+int pokefetch_watch(struct Pokefetch *ctx, struct WatchOptions *options,
+                    FILE *out);
+
+/**
+ * @brief Bring the local data up to date with the PokéAPI.
+ *
+ * @param ctx Context whose data directory is synced
+ * @param out Where the summary is written
+ * @return 0 if every resource was synced, otherwise 1
+ */
+int pokefetch_sync(struct Pokefetch *ctx, FILE *out);
+
+#pragma GCC visibility pop
+
+#endif // !POKEFETCH_H
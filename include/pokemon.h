@@ -3,10 +3,17 @@
 
 #include <stddef.h>
 
+#include "card.h"
+
 #define POKEAPI "https://pokeapi.co/api/v2"
 #define POKEMON_IMG "assets/icons/"
+#define DATA_DIR "assets"
 #define NOT_FOUND "Not Found"
 
+// Seconds before a request is abandoned, and before a stalled one is
+#define REQUEST_TIMEOUT 30
+#define REQUEST_STALL_TIME 10
+
 // Colors
 #define BG       "[48;2;"
 #define FG       "[38;2;"
@@ -50,6 +57,22 @@ struct Pokemon {
   char *desc;     /**< Description of the pokémon from the pokedex */
   char *genus;    /**< Genus/Category of the pokémon */
   char *icon;     /**< Icon of the pokémon */
+  int stats[6];   /**< Base stats: HP, Atk, Def, SpA, SpD, Spe */
+  char *abilities; /**< Abilities of the pokémon, hidden ones ending with '*' */
 };
 
+/**
+ * @struct Evolution
+ * @brief A member of the evolution line of a pokémon.
+ */
+struct Evolution {
+  char *name;  /**< Name of the pokémon */
+  char *alias; /**< Name of the pokémon in english, needed for the icon */
+  int id;      /**< ID of the pokémon in the pokedex */
+  int stage;   /**< 0 for the base form, 1 for its evolutions, and so on */
+  char *icon;  /**< Icon of the pokémon */
+};
+
+#define MAX_EVOLUTIONS 16
+
 #endif // !POKEMON_H
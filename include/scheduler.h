@@ -0,0 +1,128 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/**
+ * @struct Scheduler
+ * @brief A small scheduler resolving a graph of dependent requests.
+ *
+ * Each task of the graph optionally fetches an URL and runs a callback once
+ * its dependencies and its request are done. Callbacks may add new tasks, so
+ * the graph can grow as documents are parsed (e.g. species -> evolution chain
+ * -> members). Requests run concurrently on the connections of a single curl
+ * multi handle, with the DNS, TLS sessions and cache of the context, and each
+ * URL is only fetched once: tasks asking for the same URL share the same
+ * response. The number of requests started per second can be limited, see
+ * `scheduler_set_rate()`.
+ *
+ * A scheduler belongs to a single thread, the context may be shared.
+ */
+struct Scheduler;
+
+struct Pokefetch;
+
+/**
+ * @brief Callback run when a task is done.
+ *
+ * @param sched Scheduler running the task, new tasks can be added to it
+ * @param task ID of the task, see `scheduler_body()`
+ * @param userdata Pointer given to `scheduler_add()`
+ */
+typedef void (*task_callback)(struct Scheduler *sched, int task,
+                              void *userdata);
+
+/**
+ * @brief Create a scheduler.
+ *
+ * @param ctx Context providing the DNS, TLS sessions and cache
+ * @param max_connections Maximum number of requests running at once
+ * @return The scheduler, or `NULL` if curl could not be initialized
+ */
+struct Scheduler *scheduler_new(struct Pokefetch *ctx, int max_connections);
+
+/**
+ * @brief Add a task to the graph.
+ *
+ * The request of the task is only started once all its dependencies are
+ * done. A task without URL only waits for its dependencies, it is useful to
+ * join the results of several requests.
+ *
+ * @param sched Scheduler where the task is added
+ * @param url URL to fetch, or `NULL`
+ * @param deps IDs of the tasks this one depends on
+ * @param nb_deps Number of dependencies
+ * @param callback Function called when the task is done, may be `NULL`
+ * @param userdata Pointer given to the callback
+ * @return The ID of the task, or -1 if the allocation failed or a dependency
+ * is not the ID of a task
+ */
+int scheduler_add(struct Scheduler *sched, const char *url, const int *deps,
+                  int nb_deps, task_callback callback, void *userdata);
+
+/**
+ * @brief Add a task revalidating an URL with its ETag.
+ *
+ * The request is sent with `If-None-Match` when an ETag is given, and always
+ * goes to the network: the cache of the context is neither read nor filled.
+ * A "304 Not Modified" response is a success without body, so
+ * `scheduler_body()` returns `NULL` while `scheduler_failed()` returns 0.
+ *
+ * @param sched Scheduler where the task is added
+ * @param url URL to fetch
+ * @param etag ETag of the copy already known, `NULL` if none
+ * @param callback Function called when the task is done, may be `NULL`
+ * @param userdata Pointer given to the callback
+ * @return The ID of the task, or -1 if the allocation failed
+ */
+int scheduler_add_etag(struct Scheduler *sched, const char *url,
+                       const char *etag, task_callback callback,
+                       void *userdata);
+
+/**
+ * @brief Limit the number of requests started per second.
+ *
+ * The requests are evenly spaced, tasks wait for their turn.
+ *
+ * @param rate Maximum number of requests per second, 0 for no limit
+ */
+void scheduler_set_rate(struct Scheduler *sched, int rate);
+
+/**
+ * @brief Run the tasks until the whole graph is resolved.
+ *
+ * @param sched Scheduler to run
+ * @return 0 if every task succeeded, otherwise the number of failed tasks
+ */
+int scheduler_run(struct Scheduler *sched);
+
+/**
+ * @brief Response of the request of a task.
+ *
+ * The response belongs to the scheduler and lives until `scheduler_free()`.
+ *
+ * @return The response, or `NULL` if the task has no URL or failed
+ */
+const char *scheduler_body(struct Scheduler *sched, int task);
+
+/**
+ * @brief ETag of the response of a task added with `scheduler_add_etag()`.
+ *
+ * @return The ETag (the one sent if not modified), or `NULL` if none
+ */
+const char *scheduler_etag(struct Scheduler *sched, int task);
+
+/**
+ * @brief Check whether a task failed.
+ *
+ * A task fails when its request fails or when one of its dependencies failed,
+ * its callback only runs once all the dependencies are finished.
+ *
+ * @return 1 if the task failed, otherwise 0
+ */
+int scheduler_failed(struct Scheduler *sched, int task);
+
+/**
+ * @brief Free the scheduler and every response it fetched.
+ */
+void scheduler_free(struct Scheduler *sched);
+
+#endif // !SCHEDULER_H
@@ -0,0 +1,44 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdio.h>
+
+// Manifest of the local data, in the data directory
+#define SYNC_MANIFEST "manifest.txt"
+// Requests running at once during a sync
+#define SYNC_CONNECTIONS 8
+// Requests started per second during a sync
+#define SYNC_RATE 20
+// Resources revalidated by each sync, the ones checked the longest time ago
+#define SYNC_REVALIDATE 32
+// Responses between two rewrites of the local data
+#define SYNC_CHECKPOINT 64
+
+struct Pokefetch;
+
+/**
+ * @brief Bring the local data up to date with the PokéAPI.
+ *
+ * `manifest.txt` records the number of species upstream and, for each
+ * resource the local data is built from (the species and, when `index.bin`
+ * exists, the pokémon of each ID), its ETag and when it was last checked.
+ * A sync asks for the number of species, fetches the new ones and
+ * revalidates with their ETag the SYNC_REVALIDATE resources checked the
+ * longest time ago, so a routine sync is a handful of requests and the
+ * whole data is checked again over successive syncs.
+ *
+ * Only the entries of `pokemons.json` and the rows of `index.bin` whose
+ * resource changed are rebuilt, the others are copied as they are. The
+ * files are rewritten every SYNC_CHECKPOINT responses, so an interrupted
+ * sync resumes where it stopped. Icons come from another source, see
+ * `make icon`.
+ *
+ * The context keeps the local data it was created with.
+ *
+ * @param ctx Context of the sync
+ * @param out Where the summary is written
+ * @return 0 if every resource was synced, otherwise 1
+ */
+int sync_data(struct Pokefetch *ctx, FILE *out);
+
+#endif // !SYNC_H
@@ -0,0 +1,40 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stdio.h>
+
+#include "pokefetch.h"
+
+// Most cards rendered ahead, see `WatchOptions`
+#define WATCH_MAX_PREFETCH 3
+
+/**
+ * @brief Cycle through random pokémons until interrupted.
+ *
+ * A background thread keeps the next `prefetch` cards fetched, parsed and
+ * rendered while the current one is on screen, so a swap only writes the
+ * lines of the new card that differ from the current one. The cards are
+ * shown on the alternate screen, which is left on SIGINT or SIGTERM. On
+ * SIGWINCH the card is redrawn in full and the next ones are rendered for the
+ * new size. The handlers of these signals are replaced while the slideshow
+ * runs, then restored, so only one slideshow may run at a time in the
+ * process.
+ *
+ * @param ctx Context of the cards
+ * @param options How to cycle
+ * @param out Terminal where the cards are shown
+ * @return 0 once interrupted, 1 if the slideshow could not start
+ */
+int show_watch(struct Pokefetch *ctx, struct WatchOptions *options, FILE *out);
+
+/**
+ * @brief Parse the interval given to `--watch`.
+ *
+ * @param str A number followed by "ms", "s", "m" or "h", seconds by default
+ * (e.g., "10s", "500ms", "2m")
+ * @param interval Where the interval is stored, in ms
+ * @return 0 if the interval is valid, otherwise 1
+ */
+int parse_interval(const char *str, long *interval);
+
+#endif // !WATCH_H
@@ -0,0 +1,365 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/card.h"
+#include "../include/context.h"
+#include "../include/display.h"
+#include "../include/parser.h"
+#include "../include/scheduler.h"
+#include "../include/memstats.h"
+
+/**
+ * @struct CardJob
+ * @brief State shared by the tasks of a card.
+ */
+struct CardJob {
+  struct Pokefetch *ctx;                      /**< Context of the card */
+  struct CardOptions *options;                /**< What to show */
+  FILE *out;                                  /**< Where the card is shown */
+  struct Pokemon pokemon;                     /**< Pokémon of the card */
+  unsigned missing;                           /**< Fields left to the API */
+  int pokemon_task;                           /**< pokemon document */
+  int species_task;                           /**< pokemon-species document */
+  int card_task;                              /**< Display of the card */
+  int status;                                 /**< 0 if the card was shown */
+  int failed;                                 /**< A task could not be added */
+  struct Evolution members[MAX_EVOLUTIONS];   /**< Evolution line */
+  int nb_members;                             /**< Number of members */
+  int member_tasks[MAX_EVOLUTIONS];           /**< Species of the members */
+  int icon_tasks[MAX_EVOLUTIONS];             /**< Icons of the members */
+};
+
+// Columns kept on the right of the icon for the text, the description being
+// wrapped at 40 columns
+#define CARD_TEXT_WIDTH 42
+
+// Fields found in each endpoint
+#define POKEMON_FIELDS                                                         \
+  (FIELD_TYPES | FIELD_HEIGHT | FIELD_WEIGHT | FIELD_STATS | FIELD_ABILITIES)
+#define SPECIES_FIELDS (FIELD_DESC | FIELD_EVOLUTIONS)
+
+int parse_fields(const char *str, unsigned *fields) {
+  struct FieldMapping {
+    const char *name;
+    unsigned value;
+  };
+  struct FieldMapping fieldMappings[] = {
+      {"name", FIELD_NAME},     {"genus", FIELD_GENUS},
+      {"types", FIELD_TYPES},   {"height", FIELD_HEIGHT},
+      {"weight", FIELD_WEIGHT}, {"desc", FIELD_DESC},
+      {"stats", FIELD_STATS},   {"abilities", FIELD_ABILITIES},
+      {"icon", FIELD_ICON},     {"evolutions", FIELD_EVOLUTIONS},
+      {"all", ~0u}};
+  size_t numFields = sizeof(fieldMappings) / sizeof(fieldMappings[0]);
+
+  if (str == NULL)
+    return 1;
+  *fields = 0;
+  while (*str) {
+    size_t len = strcspn(str, ",");
+    size_t i;
+    for (i = 0; i < numFields; i++) {
+      if (strlen(fieldMappings[i].name) == len &&
+          strncmp(str, fieldMappings[i].name, len) == 0) {
+        *fields |= fieldMappings[i].value;
+        break;
+      }
+    }
+    if (i == numFields)
+      return 1;
+    str += len;
+    if (*str == ',')
+      str++;
+  }
+  return 0;
+}
+
+/**
+ * @brief Build the URL of a resource of the PokéAPI.
+ */
+static void api_url(struct CardJob *job, char *buf, size_t len,
+                    const char *data, int id) {
+  snprintf(buf, len, "%s/%s/%d/", job->ctx->api, data, id);
+}
+
+/**
+ * @brief Fill the fields known by the index of the species.
+ *
+ * The types and the base stats are in `index.bin`, so the pokemon endpoint is
+ * only needed for the other fields.
+ *
+ * @return The fields that were filled
+ */
+static unsigned parse_indexed_pokemon(struct CardJob *job, unsigned fields) {
+  const struct DexIndex *dex = &job->ctx->dex;
+  int i = job->options->id - 1;
+  unsigned filled = 0;
+  if (!dex->has_types || i < 0 || i >= dex->count)
+    return 0;
+
+  if (fields & FIELD_TYPES) {
+    for (int t = 0; t < 2; t++) {
+      const char *type = dex_type_name(dex->types[2 * i + t]);
+      if (type)
+        job->pokemon.types[t] = mem_strdup(type);
+    }
+    filled |= FIELD_TYPES;
+  }
+  if (fields & FIELD_STATS) {
+    for (int s = 0; s < 6; s++)
+      job->pokemon.stats[s] = dex->stats[6 * i + s];
+    filled |= FIELD_STATS;
+  }
+  return filled;
+}
+
+/**
+ * @brief Columns available for an icon.
+ *
+ * @param columns Width of the terminal, 0 if unknown
+ * @param reserved Columns used by something else
+ * @param nb_icons Number of icons side by side
+ * @return The width, at least 1, or 0 for no limit
+ */
+static int icon_width(int columns, int reserved, int nb_icons) {
+  if (columns <= 0)
+    return 0;
+  int width = (columns - reserved) / (nb_icons > 0 ? nb_icons : 1);
+  return width > 0 ? width : 1;
+}
+
+/**
+ * @brief Load an icon in the color depth of the card.
+ *
+ * @param width Columns available for the icon, 0 for no limit
+ * @return A dynamically allocated string with the icon, or "Not Found"
+ */
+static char *card_icon(struct CardJob *job, const char *shiny,
+                       const char *alias, int width) {
+  // Lines are two pixels high, the last line of the terminal is the prompt
+  int height = job->options->rows > 1 ? job->options->rows - 1 : 0;
+  enum MemPhase phase = mem_phase(MEM_ICON);
+  char *icon = load_colored_icon(job->ctx->data_dir, shiny, alias,
+                                 job->options->mode, width, height);
+  mem_phase(phase);
+  return icon;
+}
+
+/**
+ * @brief Parse the documents fetched for the card and display it.
+ *
+ * @param json_str pokemon document, `NULL` if not needed
+ * @param json_spe_str pokemon-species document, `NULL` if not needed
+ */
+static void render_card(struct CardJob *job, const char *json_str,
+                        const char *json_spe_str) {
+  struct CardOptions *options = job->options;
+  struct Pokemon *pokemon = &job->pokemon;
+
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  int failed = 0;
+  if (json_str && parse_pokemon_json(pokemon, json_str, job->missing)) {
+    fprintf(stderr, "parse_pokemon_json() failed.\n");
+    failed = 1;
+  } else if (json_spe_str && parse_species_json(pokemon, json_spe_str,
+                                                options->version, options->lang,
+                                                job->missing)) {
+    fprintf(stderr, "parse_species_json() failed.\n");
+    failed = 1;
+  }
+  mem_phase(phase);
+  if (failed)
+    return;
+  if ((options->fields & FIELD_ICON) && strcmp(pokemon->alias, NOT_FOUND) != 0)
+    pokemon->icon = card_icon(job, options->shiny, pokemon->alias,
+                              icon_width(options->columns, CARD_TEXT_WIDTH, 1));
+
+  if (display(job->out, pokemon, options->shiny, options->mode,
+              options->fields) != 0) {
+    fprintf(stderr, "Error displaying pokemon.\n");
+  } else {
+    job->status = 0;
+  }
+  fflush(job->out);
+}
+
+static void on_card(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  (void)task;
+
+  const char *json_str = scheduler_body(sched, job->pokemon_task);
+  const char *json_spe_str = scheduler_body(sched, job->species_task);
+  if ((job->pokemon_task >= 0 && json_str == NULL) ||
+      (job->species_task >= 0 && json_spe_str == NULL)) {
+    fprintf(stderr, "Error in card.c: Failed to fetch pokemon %d.\n",
+            job->options->id);
+    return;
+  }
+  render_card(job, json_str, json_spe_str);
+}
+
+static void on_member(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  const char *json_spe_str = scheduler_body(sched, task);
+  if (json_spe_str == NULL)
+    return; // Keep the english name
+
+  for (int i = 0; i < job->nb_members; i++) {
+    if (job->member_tasks[i] != task)
+      continue;
+    enum MemPhase phase = mem_phase(MEM_PARSE);
+    char *name = parse_species_name(json_spe_str, job->options->lang);
+    mem_phase(phase);
+    if (strcmp(name, NOT_FOUND) != 0) {
+      mem_free(job->members[i].name);
+      job->members[i].name = name;
+    }
+  }
+}
+
+static void on_icon(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  (void)sched;
+
+  // The icons of the line are side by side
+  int width = icon_width(job->options->columns, 0, job->nb_members);
+  for (int i = 0; i < job->nb_members; i++) {
+    if (job->icon_tasks[i] == task)
+      job->members[i].icon =
+          card_icon(job, "regular", job->members[i].alias, width);
+  }
+}
+
+static void on_evolutions(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  (void)sched;
+  (void)task;
+
+  // Members whose species failed keep their english name, see on_member()
+  if (job->status != 0)
+    return;
+  display_evolutions(job->out, job->members, job->nb_members,
+                     job->options->id, job->options->mode);
+}
+
+static void on_chain(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  const char *json_str = scheduler_body(sched, task);
+  if (json_str == NULL)
+    return;
+
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  job->nb_members =
+      parse_evolution_chain(json_str, job->members, MAX_EVOLUTIONS);
+  mem_phase(phase);
+
+  // Species and icon of each member, then the line once they are all there
+  int deps[2 * MAX_EVOLUTIONS + 1];
+  int nb_deps = 0;
+  char url[512];
+  for (int i = 0; i < job->nb_members; i++) {
+    api_url(job, url, sizeof(url), "pokemon-species", job->members[i].id);
+    job->member_tasks[i] = scheduler_add(sched, url, NULL, 0, on_member, job);
+    job->icon_tasks[i] = scheduler_add(sched, NULL, NULL, 0, on_icon, job);
+    if (job->member_tasks[i] < 0 || job->icon_tasks[i] < 0) {
+      fprintf(stderr, "Error in card.c: Failed to add the evolution line.\n");
+      job->failed = 1;
+      return;
+    }
+    deps[nb_deps++] = job->member_tasks[i];
+    deps[nb_deps++] = job->icon_tasks[i];
+  }
+  // The line is printed under the card
+  deps[nb_deps++] = job->card_task;
+  if (scheduler_add(sched, NULL, deps, nb_deps, on_evolutions, job) < 0) {
+    fprintf(stderr, "Error in card.c: Failed to add the evolution line.\n");
+    job->failed = 1;
+  }
+}
+
+static void on_species(struct Scheduler *sched, int task, void *userdata) {
+  struct CardJob *job = userdata;
+  const char *json_spe_str = scheduler_body(sched, task);
+  if (json_spe_str == NULL || !(job->options->fields & FIELD_EVOLUTIONS))
+    return;
+
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  char *url = get_evolution_chain(json_spe_str);
+  mem_phase(phase);
+  if (url == NULL)
+    return;
+  if (scheduler_add(sched, url, NULL, 0, on_chain, job) < 0) {
+    fprintf(stderr, "Error in card.c: Failed to add the evolution line.\n");
+    job->failed = 1;
+  }
+  mem_free(url);
+}
+
+int show_card(struct Pokefetch *ctx, struct CardOptions *options, FILE *out) {
+  struct CardJob job = {0};
+  job.ctx = ctx;
+  job.options = options;
+  job.out = out;
+  job.pokemon = (struct Pokemon){NOT_FOUND, NOT_FOUND, options->id,
+    {NOT_FOUND, NOT_FOUND}, 0, 0, NOT_FOUND, NOT_FOUND, NOT_FOUND, {0},
+    NOT_FOUND};
+  job.pokemon_task = -1;
+  job.species_task = -1;
+  job.status = 1;
+
+  // Local data first, then only the endpoints of the missing fields
+  unsigned fields = options->fields;
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  parse_local_pokemon(ctx, &job.pokemon, options->id, options->lang, fields);
+  mem_phase(phase);
+  fields &= ~parse_indexed_pokemon(&job, fields);
+  job.missing = fields;
+  int need_pokemon = (fields & POKEMON_FIELDS) ||
+      ((fields & FIELD_ICON) && strcmp(job.pokemon.alias, NOT_FOUND) == 0);
+  int need_species = (fields & SPECIES_FIELDS) ||
+      ((fields & FIELD_NAME) && strcmp(job.pokemon.name, NOT_FOUND) == 0) ||
+      ((fields & FIELD_GENUS) && strcmp(job.pokemon.genus, NOT_FOUND) == 0);
+
+  if (!need_pokemon && !need_species) {
+    render_card(&job, NULL, NULL);
+    free_pokemon(&job.pokemon);
+    return job.status;
+  }
+
+  struct Scheduler *sched = scheduler_new(ctx, 6);
+  if (sched == NULL) {
+    free_pokemon(&job.pokemon);
+    return 1;
+  }
+
+  char url[512];
+  int deps[2];
+  int nb_deps = 0;
+  if (need_pokemon) {
+    api_url(&job, url, sizeof(url), "pokemon", options->id);
+    job.pokemon_task = scheduler_add(sched, url, NULL, 0, NULL, NULL);
+    deps[nb_deps++] = job.pokemon_task;
+  }
+  if (need_species) {
+    api_url(&job, url, sizeof(url), "pokemon-species", options->id);
+    job.species_task = scheduler_add(sched, url, NULL, 0, on_species, &job);
+    deps[nb_deps++] = job.species_task;
+  }
+  // A task that could not be added (-1) is rejected as a dependency, so the
+  // card task fails with it
+  job.card_task = scheduler_add(sched, NULL, deps, nb_deps, on_card, &job);
+  if (job.card_task < 0) {
+    fprintf(stderr, "Error in card.c: Failed to add the tasks of pokemon %d.\n",
+            options->id);
+    job.failed = 1;
+  } else {
+    scheduler_run(sched);
+  }
+
+  free_evolutions(job.members, job.nb_members);
+  free_pokemon(&job.pokemon);
+  scheduler_free(sched);
+  return job.failed ? 1 : job.status;
+}
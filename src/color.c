@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/color.h"
+#include "../include/memstats.h"
+
+// The 16 ANSI colors as rendered by xterm
+static const unsigned char ansi16[16][3] = {
+    {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},
+    {0, 0, 238},     {205, 0, 205},   {0, 205, 205},   {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+    {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255}};
+
+// Levels of each channel in the 6x6x6 cube of the xterm-256 palette
+static const int cube_levels[6] = {0, 95, 135, 175, 215, 255};
+
+static int distance(int r1, int g1, int b1, int r2, int g2, int b2) {
+  return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+}
+
+static int nearest_level(int value) {
+  int best = 0;
+  for (int i = 1; i < 6; i++) {
+    if (abs(cube_levels[i] - value) < abs(cube_levels[best] - value))
+      best = i;
+  }
+  return best;
+}
+
+int rgb_to_256(int r, int g, int b) {
+  // Nearest color in the cube
+  int ri = nearest_level(r), gi = nearest_level(g), bi = nearest_level(b);
+  int cube = 16 + 36 * ri + 6 * gi + bi;
+  int cube_dist = distance(r, g, b, cube_levels[ri], cube_levels[gi],
+                           cube_levels[bi]);
+
+  // Nearest color in the gray ramp (8, 18, ..., 238)
+  int avg = (r + g + b) / 3;
+  int gray = avg < 8 ? 0 : (avg - 8 + 5) / 10;
+  if (gray > 23)
+    gray = 23;
+  int level = 8 + 10 * gray;
+  int gray_dist = distance(r, g, b, level, level, level);
+
+  return gray_dist < cube_dist ? 232 + gray : cube;
+}
+
+int rgb_to_16(int r, int g, int b) {
+  int best = 0;
+  int best_dist = distance(r, g, b, ansi16[0][0], ansi16[0][1], ansi16[0][2]);
+  for (int i = 1; i < 16; i++) {
+    int dist = distance(r, g, b, ansi16[i][0], ansi16[i][1], ansi16[i][2]);
+    if (dist < best_dist) {
+      best = i;
+      best_dist = dist;
+    }
+  }
+  return best;
+}
+
+enum ColorMode detect_color_mode(void) {
+  const char *no_color = getenv("NO_COLOR");
+  if (no_color && no_color[0] != '\0')
+    return COLOR_NONE;
+
+  const char *colorterm = getenv("COLORTERM");
+  if (colorterm && (strcmp(colorterm, "truecolor") == 0 ||
+                    strcmp(colorterm, "24bit") == 0))
+    return COLOR_TRUE;
+
+  const char *term = getenv("TERM");
+  if (term == NULL || term[0] == '\0' || strcmp(term, "dumb") == 0)
+    return COLOR_NONE;
+  if (strstr(term, "truecolor") || strstr(term, "direct"))
+    return COLOR_TRUE;
+  if (strstr(term, "256color"))
+    return COLOR_256;
+  return COLOR_16;
+}
+
+int parse_color_mode(const char *str, enum ColorMode *mode) {
+  if (str == NULL)
+    return 1;
+  if (strcmp(str, "none") == 0) {
+    *mode = COLOR_NONE;
+  } else if (strcmp(str, "16") == 0) {
+    *mode = COLOR_16;
+  } else if (strcmp(str, "256") == 0) {
+    *mode = COLOR_256;
+  } else if (strcmp(str, "true") == 0 || strcmp(str, "truecolor") == 0 ||
+             strcmp(str, "24bit") == 0) {
+    *mode = COLOR_TRUE;
+  } else {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Write a quantized color escape sequence.
+ *
+ * @param buf Where the sequence is written
+ * @param len Size of the buffer
+ * @param mode COLOR_256 or COLOR_16
+ * @param bg 1 for a background color, 0 for a foreground one
+ * @param index Index of the color in the palette of the mode
+ * @return The length of the sequence
+ */
+static int write_index(char *buf, size_t len, enum ColorMode mode, int bg,
+                       int index) {
+  char seq[16];
+  int n = 0;
+  int code;
+
+  // Written by hand, icons have thousands of these sequences
+  seq[n++] = '\033';
+  seq[n++] = '[';
+  if (mode == COLOR_256) {
+    seq[n++] = bg ? '4' : '3';
+    seq[n++] = '8';
+    seq[n++] = ';';
+    seq[n++] = '5';
+    seq[n++] = ';';
+    code = index;
+  } else {
+    code = index < 8 ? (bg ? 40 : 30) + index : (bg ? 100 : 90) + index - 8;
+  }
+  if (code >= 100)
+    seq[n++] = '0' + code / 100;
+  if (code >= 10)
+    seq[n++] = '0' + code / 10 % 10;
+  seq[n++] = '0' + code % 10;
+  seq[n++] = 'm';
+
+  if ((size_t)n >= len)
+    return 0;
+  memcpy(buf, seq, n);
+  buf[n] = '\0';
+  return n;
+}
+
+int format_color(char *buf, size_t len, enum ColorMode mode, const char *layer,
+                 const char *rgb) {
+  int r = 0, g = 0, b = 0;
+  int bg = strcmp(layer, BG) == 0;
+
+  if (len > 0)
+    buf[0] = '\0';
+  switch (mode) {
+  case COLOR_NONE:
+    return 0;
+  case COLOR_TRUE:
+    return snprintf(buf, len, "%s%s", layer, rgb);
+  default:
+    sscanf(rgb, "%d;%d;%d", &r, &g, &b);
+    return write_index(buf, len, mode, bg,
+                       mode == COLOR_256 ? rgb_to_256(r, g, b)
+                                         : rgb_to_16(r, g, b));
+  }
+}
+
+/**
+ * @brief Slot of a color in the hash table of a palette.
+ */
+static int hash_color(int r, int g, int b, int nb_slots) {
+  unsigned key = (unsigned)r << 16 | (unsigned)g << 8 | (unsigned)b;
+  // Fibonacci hashing, the high bits are the best mixed
+  return (key * 2654435761u) >> 8 & (nb_slots - 1);
+}
+
+/**
+ * @brief Index the entries of a palette by color.
+ *
+ * @return 0 if the index was built, otherwise 1
+ */
+static int index_palette(struct Palette *palette) {
+  // At most half full, so that probes stay short
+  palette->nb_slots = 16;
+  while (palette->nb_slots < 2 * palette->size)
+    palette->nb_slots *= 2;
+  palette->slots = mem_calloc(palette->nb_slots, sizeof(*palette->slots));
+  if (palette->slots == NULL)
+    return 1;
+
+  for (int i = 0; i < palette->size; i++) {
+    const struct PaletteEntry *entry = &palette->entries[i];
+    int slot = hash_color(entry->r, entry->g, entry->b, palette->nb_slots);
+    while (palette->slots[slot]) {
+      // The first entry of a color wins, as in the table
+      const struct PaletteEntry *other =
+          &palette->entries[palette->slots[slot] - 1];
+      if (other->r == entry->r && other->g == entry->g && other->b == entry->b)
+        break;
+      slot = (slot + 1) & (palette->nb_slots - 1);
+    }
+    if (palette->slots[slot] == 0)
+      palette->slots[slot] = i + 1;
+  }
+  return 0;
+}
+
+int load_palette(const char *filename, struct Palette *palette) {
+  palette->entries = NULL;
+  palette->size = 0;
+  palette->slots = NULL;
+  palette->nb_slots = 0;
+
+  FILE *file = fopen(filename, "r");
+  if (file == NULL)
+    return 1;
+
+  int capacity = 0;
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    int v[10];
+    int nb = sscanf(line, "%d %d %d %d %d %d %d %d %d %d", &v[0], &v[1],
+                    &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9]);
+    if (nb != 5 && nb != 10)
+      break;
+    // Tables without shiny colors draw the regular sprite
+    if (nb == 5)
+      memcpy(v + 5, v, 5 * sizeof(*v));
+
+    if (palette->size == capacity) {
+      capacity = capacity ? capacity * 2 : 32;
+      struct PaletteEntry *ptr =
+          mem_realloc(palette->entries, capacity * sizeof(*ptr));
+      if (ptr == NULL) {
+        free_palette(palette);
+        fclose(file);
+        return 1;
+      }
+      palette->entries = ptr;
+    }
+    palette->entries[palette->size++] = (struct PaletteEntry){
+        v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9]};
+  }
+  fclose(file);
+
+  if (index_palette(palette) != 0) {
+    free_palette(palette);
+    return 1;
+  }
+  return 0;
+}
+
+void free_palette(struct Palette *palette) {
+  mem_free(palette->entries);
+  mem_free(palette->slots);
+  palette->entries = NULL;
+  palette->size = 0;
+  palette->slots = NULL;
+  palette->nb_slots = 0;
+}
+
+/**
+ * @brief Find a color in the table of the icon.
+ *
+ * @return The entry of the color, or `NULL` if missing from the table
+ */
+static const struct PaletteEntry *lookup(const struct Palette *palette, int r,
+                                         int g, int b) {
+  if (palette->slots == NULL)
+    return NULL;
+  int slot = hash_color(r, g, b, palette->nb_slots);
+  while (palette->slots[slot]) {
+    const struct PaletteEntry *entry =
+        &palette->entries[palette->slots[slot] - 1];
+    if (entry->r == r && entry->g == g && entry->b == b)
+      return entry;
+    slot = (slot + 1) & (palette->nb_slots - 1);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Write a 24-bit color escape sequence.
+ *
+ * @return The length of the sequence
+ */
+static int write_rgb(char *buf, int bg, int r, int g, int b) {
+  char *write = buf;
+  int values[3] = {r, g, b};
+
+  memcpy(write, bg ? "\033[48;2" : "\033[38;2", 6);
+  write += 6;
+  for (int i = 0; i < 3; i++) {
+    *write++ = ';';
+    if (values[i] >= 100)
+      *write++ = '0' + values[i] / 100;
+    if (values[i] >= 10)
+      *write++ = '0' + values[i] / 10 % 10;
+    *write++ = '0' + values[i] % 10;
+  }
+  *write++ = 'm';
+  return write - buf;
+}
+
+int format_entry(char *buf, enum ColorMode mode, int bg,
+                 const struct PaletteEntry *entry, int shiny) {
+  switch (mode) {
+  case COLOR_NONE:
+    buf[0] = '\0';
+    return 0;
+  case COLOR_TRUE:
+    if (shiny)
+      return write_rgb(buf, bg, entry->sr, entry->sg, entry->sb);
+    return write_rgb(buf, bg, entry->r, entry->g, entry->b);
+  case COLOR_256:
+    return write_index(buf, 20, mode, bg, shiny ? entry->sc256 : entry->c256);
+  default:
+    return write_index(buf, 20, mode, bg, shiny ? entry->sc16 : entry->c16);
+  }
+}
+
+/**
+ * @brief Write the sequence of a color of the icon in a color mode.
+ *
+ * @return The length of the sequence
+ */
+static int write_color(char *buf, enum ColorMode mode,
+                       const struct Palette *palette, int shiny,
+                       const int values[4]) {
+  int bg = values[0] == 48;
+  int r = values[1], g = values[2], b = values[3];
+  const struct PaletteEntry *entry = lookup(palette, r, g, b);
+
+  if (mode == COLOR_TRUE) {
+    if (shiny && entry)
+      return write_rgb(buf, bg, entry->sr, entry->sg, entry->sb);
+    return write_rgb(buf, bg, r, g, b);
+  }
+  int index;
+  if (entry && mode == COLOR_256)
+    index = shiny ? entry->sc256 : entry->c256;
+  else if (entry)
+    index = shiny ? entry->sc16 : entry->c16;
+  else
+    index = mode == COLOR_256 ? rgb_to_256(r, g, b) : rgb_to_16(r, g, b);
+  return write_index(buf, 16, mode, bg, index);
+}
+
+/**
+ * @brief Parse a 24-bit color sequence (e.g. `\033[38;2;230;40;40m`).
+ *
+ * `sscanf()` is avoided on purpose: it measures the whole remaining icon on
+ * every call, which makes the quantization quadratic.
+ *
+ * @param seq Start of the sequence
+ * @param values Where the layer and the three channels are stored
+ * @return 1 if the sequence is a 24-bit color, otherwise 0
+ */
+static int parse_rgb_sequence(const char *seq, int values[4]) {
+  if (seq[0] != '\033' || seq[1] != '[')
+    return 0;
+  seq += 2;
+  for (int i = 0; i < 5; i++) {
+    int value = 0;
+    if (*seq < '0' || *seq > '9')
+      return 0;
+    while (*seq >= '0' && *seq <= '9')
+      value = value * 10 + *seq++ - '0';
+    // The second number is the 2 of "38;2;r;g;b"
+    if (i == 1) {
+      if (value != 2)
+        return 0;
+    } else {
+      values[i == 0 ? 0 : i - 1] = value;
+    }
+    if (*seq != (i == 4 ? 'm' : ';'))
+      return 0;
+    seq++;
+  }
+  return 1;
+}
+
+char *color_icon(const char *icon, enum ColorMode mode,
+                 const struct Palette *palette, int shiny) {
+  // The shortest 24-bit sequence is 13 bytes long and the longest 19
+  size_t len = strlen(icon);
+  char *result = mem_malloc(len + len / 2 + 1);
+  if (result == NULL)
+    return NULL;
+
+  const char *read = icon;
+  char *write = result;
+  while (*read) {
+    if (*read != '\033') {
+      *write++ = *read++;
+      continue;
+    }
+
+    // Find the end of the escape sequence
+    const char *end = read + 1;
+    while (*end && *end != 'm')
+      end++;
+    if (*end == '\0')
+      break;
+
+    int values[4];
+    if (mode != COLOR_NONE && parse_rgb_sequence(read, values)) {
+      write += write_color(write, mode, palette, shiny, values);
+    } else if (mode != COLOR_NONE) {
+      // Not a 24-bit color (e.g. a reset), keep it as is
+      memcpy(write, read, end - read + 1);
+      write += end - read + 1;
+    }
+    read = end + 1;
+  }
+  *write = '\0';
+  return result;
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/context.h"
+#include "../include/grid.h"
+#include "../include/parser.h"
+#include "../include/memstats.h"
+#include "../include/sync.h"
+#include "../include/watch.h"
+
+// curl_global_init() is not thread safe, it is done once for every context
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+static int global_users = 0;
+
+static void share_lock(CURL *handle, curl_lock_data data,
+                       curl_lock_access access, void *userptr) {
+  struct Pokefetch *ctx = userptr;
+  (void)handle;
+  (void)access;
+  pthread_mutex_lock(&ctx->share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+  struct Pokefetch *ctx = userptr;
+  (void)handle;
+  pthread_mutex_unlock(&ctx->share_locks[data]);
+}
+
+struct Pokefetch *pokefetch_new(const char *data_dir, const char *api) {
+  struct Pokefetch *ctx = mem_calloc(1, sizeof(*ctx));
+  if (ctx == NULL)
+    return NULL;
+
+  ctx->data_dir = mem_strdup(data_dir ? data_dir : DATA_DIR);
+  ctx->api = mem_strdup(api ? api : POKEAPI);
+  if (ctx->data_dir == NULL || ctx->api == NULL) {
+    mem_free(ctx->data_dir);
+    mem_free(ctx->api);
+    mem_free(ctx);
+    return NULL;
+  }
+
+  pthread_mutex_lock(&global_lock);
+  if (global_users++ == 0) {
+    // curl allocates through the hooks too when they count, see memstats.h
+    if (mem_stats_enabled())
+      curl_global_init_mem(CURL_GLOBAL_DEFAULT, mem_malloc, mem_free,
+                           mem_realloc, mem_strdup, mem_calloc);
+    else
+      curl_global_init(CURL_GLOBAL_DEFAULT);
+  }
+  pthread_mutex_unlock(&global_lock);
+
+  // DNS, TLS sessions and cookies are shared by every request. Connections
+  // are not, libcurl cannot share them between threads: each scheduler keeps
+  // its own in its multi handle
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    pthread_mutex_init(&ctx->share_locks[i], NULL);
+  ctx->share = curl_share_init();
+  if (ctx->share) {
+    curl_share_setopt(ctx->share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(ctx->share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(ctx->share, CURLSHOPT_USERDATA, ctx);
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(ctx->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+  }
+
+  pthread_rwlock_init(&ctx->cache_lock, NULL);
+  char path[512];
+  snprintf(path, sizeof(path), "%s/pokemons.json", ctx->data_dir);
+  // Mapped and tokenized in place, nothing is copied out of the file
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  int loaded = json_load(&ctx->local, path) == 0;
+  mem_phase(phase);
+  if (loaded &&
+      json_type(&ctx->local, 0) != JSON_ARRAY) {
+    fprintf(stderr, "Local pokemons JSON parsing failed\n");
+    json_free(&ctx->local);
+  }
+  dex_load(&ctx->dex, ctx->data_dir, json_size(&ctx->local, 0));
+  pokefetch_seed(ctx, (unsigned long long)time(NULL) ^
+                          ((unsigned long long)getpid() << 32));
+  return ctx;
+}
+
+void pokefetch_free(struct Pokefetch *ctx) {
+  if (ctx == NULL)
+    return;
+
+  for (int i = 0; i < CACHE_SIZE; i++) {
+    mem_free(ctx->cache[i].url);
+    mem_free(ctx->cache[i].body);
+  }
+  pthread_rwlock_destroy(&ctx->cache_lock);
+  json_free(&ctx->local);
+  dex_free(&ctx->dex);
+  // Tape of the documents of this thread, the other threads free theirs
+  json_release();
+
+  if (ctx->share)
+    curl_share_cleanup(ctx->share);
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    pthread_mutex_destroy(&ctx->share_locks[i]);
+
+  pthread_mutex_lock(&global_lock);
+  if (--global_users == 0)
+    curl_global_cleanup();
+  pthread_mutex_unlock(&global_lock);
+
+  mem_free(ctx->data_dir);
+  mem_free(ctx->api);
+  mem_free(ctx);
+}
+
+void pokefetch_seed(struct Pokefetch *ctx, unsigned long long seed) {
+  atomic_store(&ctx->rng, seed);
+}
+
+/**
+ * @brief Next number of the random number generator of the context.
+ */
+static uint64_t next_random(struct Pokefetch *ctx) {
+  // splitmix64, the state only needs an atomic add so threads never wait
+  uint64_t z = atomic_fetch_add(&ctx->rng, 0x9E3779B97F4A7C15ULL) +
+               0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+int pokefetch_random(struct Pokefetch *ctx, int min, int max) {
+  return min + (int)(next_random(ctx) % (uint64_t)(max - min + 1));
+}
+
+int pokefetch_random_id(struct Pokefetch *ctx, const struct DexFilter *filter) {
+  if (ctx->dex.count > 0)
+    return dex_pick(&ctx->dex, filter, next_random(ctx));
+
+  // Without any local data, only an unfiltered pick is possible
+  struct DexFilter none = {0};
+  if (memcmp(filter, &none, sizeof(none)) != 0)
+    return 0;
+  int count = pokefetch_count(ctx);
+  return count > 0 ? pokefetch_random(ctx, 1, count) : 0;
+}
+
+int pokefetch_select(struct Pokefetch *ctx, const struct DexFilter *filter,
+                     int *ids, int max) {
+  if (ctx->dex.count > 0)
+    return dex_select(&ctx->dex, filter, ids, max);
+
+  struct DexFilter none = {0};
+  if (memcmp(filter, &none, sizeof(none)) != 0)
+    return 0;
+  int count = pokefetch_count(ctx);
+  int nb = 0;
+  while (nb < count && nb < max) {
+    ids[nb] = nb + 1;
+    nb++;
+  }
+  return nb;
+}
+
+int pokefetch_indexed(struct Pokefetch *ctx) {
+  return ctx->dex.has_types;
+}
+
+int pokefetch_count(struct Pokefetch *ctx) {
+  int count = json_size(&ctx->local, 0);
+  if (count == 0)
+    count = pokemon_count(ctx);
+  return count;
+}
+
+const struct JsonDoc *local_pokemons(struct Pokefetch *ctx) {
+  return ctx->local.nb_tokens > 0 ? &ctx->local : NULL;
+}
+
+char *cache_get(struct Pokefetch *ctx, const char *url) {
+  char *result = NULL;
+  pthread_rwlock_rdlock(&ctx->cache_lock);
+  for (int i = 0; i < CACHE_SIZE; i++) {
+    if (ctx->cache[i].url && strcmp(ctx->cache[i].url, url) == 0) {
+      result = mem_strdup(ctx->cache[i].body);
+      break;
+    }
+  }
+  pthread_rwlock_unlock(&ctx->cache_lock);
+  return result;
+}
+
+void cache_put(struct Pokefetch *ctx, const char *url, const char *body) {
+  char *url_copy = mem_strdup(url);
+  char *body_copy = mem_strdup(body);
+  if (url_copy == NULL || body_copy == NULL) {
+    mem_free(url_copy);
+    mem_free(body_copy);
+    return;
+  }
+
+  pthread_rwlock_wrlock(&ctx->cache_lock);
+  struct CacheEntry *entry = &ctx->cache[ctx->cache_next];
+  ctx->cache_next = (ctx->cache_next + 1) % CACHE_SIZE;
+  mem_free(entry->url);
+  mem_free(entry->body);
+  entry->url = url_copy;
+  entry->body = body_copy;
+  pthread_rwlock_unlock(&ctx->cache_lock);
+}
+
+int pokefetch_render(struct Pokefetch *ctx, struct CardOptions *options,
+                     FILE *out) {
+  enum MemPhase phase = mem_phase(MEM_RENDER);
+  int status = show_card(ctx, options, out);
+  mem_phase(phase);
+  return status;
+}
+
+int pokefetch_render_grid(struct Pokefetch *ctx, const int *ids, int nb_ids,
+                          struct GridOptions *options, FILE *out) {
+  enum MemPhase phase = mem_phase(MEM_RENDER);
+  int status = show_grid(ctx, ids, nb_ids, options, out);
+  mem_phase(phase);
+  return status;
+}
+
+int pokefetch_watch(struct Pokefetch *ctx, struct WatchOptions *options,
+                    FILE *out) {
+  enum MemPhase phase = mem_phase(MEM_RENDER);
+  int status = show_watch(ctx, options, out);
+  mem_phase(phase);
+  return status;
+}
+
+int pokefetch_sync(struct Pokefetch *ctx, FILE *out) {
+  return sync_data(ctx, out);
+}
+
+char *pokefetch_render_string(struct Pokefetch *ctx,
+                              struct CardOptions *options) {
+  char *result = NULL;
+  size_t size = 0;
+  FILE *out = open_memstream(&result, &size);
+  if (out == NULL)
+    return NULL;
+
+  enum MemPhase phase = mem_phase(MEM_RENDER);
+  int status = show_card(ctx, options, out);
+  fclose(out);
+  mem_phase(phase);
+  // Allocated by open_memstream(), not by mem_malloc()
+  if (status != 0) {
+    free(result);
+    return NULL;
+  }
+  return result;
+}
+
+void pokefetch_free_string(char *str) {
+  // Every string of the API comes from open_memstream()
+  free(str);
+}
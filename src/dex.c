@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/dex.h"
+#include "../include/memstats.h"
+
+// Types in the order of the PokéAPI IDs, as stored in `index.bin`
+static const char *type_names[DEX_NB_TYPES] = {
+    "normal", "fighting", "flying",   "poison",  "ground", "rock",
+    "bug",    "ghost",    "steel",    "fire",    "water",  "grass",
+    "electric", "psychic", "ice",     "dragon",  "dark",   "fairy"};
+
+// Generations in the order of the PokéAPI IDs
+static const char *gen_names[DEX_NB_GENERATIONS] = {
+    "generation-i",  "generation-ii",  "generation-iii",
+    "generation-iv", "generation-v",   "generation-vi",
+    "generation-vii", "generation-viii", "generation-ix"};
+
+// Last ID of each generation, used when `index.bin` is missing
+static const int gen_last_id[DEX_NB_GENERATIONS] = {151, 251, 386, 493, 649,
+                                                721, 809, 905, 1025};
+
+#define INDEX_MAGIC "PKDX"
+#define INDEX_VERSION 1
+
+int dex_type(const char *name) {
+  for (int i = 0; i < DEX_NB_TYPES; i++) {
+    if (strcmp(name, type_names[i]) == 0)
+      return i;
+  }
+  return -1;
+}
+
+const char *dex_type_name(int type) {
+  if (type < 0 || type >= DEX_NB_TYPES)
+    return NULL;
+  return type_names[type];
+}
+
+int dex_generation(const char *name) {
+  for (int i = 0; i < DEX_NB_GENERATIONS; i++) {
+    if (strcmp(name, gen_names[i]) == 0)
+      return i + 1;
+  }
+  return 0;
+}
+
+int dex_parse_gens(const char *str, uint16_t *gens) {
+  if (str == NULL)
+    return 1;
+  while (*str) {
+    char *end;
+    long first = strtol(str, &end, 10);
+    long last = first;
+    if (end == str)
+      return 1;
+    if (*end == '-') {
+      str = end + 1;
+      last = strtol(str, &end, 10);
+      if (end == str)
+        return 1;
+    }
+    if (first < 1 || last > DEX_NB_GENERATIONS || first > last)
+      return 1;
+    for (long gen = first; gen <= last; gen++)
+      *gens |= 1 << (gen - 1);
+    str = end;
+    if (*str == ',')
+      str++;
+    else if (*str)
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Allocate the columns and the bitsets of the index in one block.
+ *
+ * @return 0 if the allocation succeeded, otherwise 1
+ */
+static int dex_alloc(struct DexIndex *index, int count) {
+  int words = (count + 63) / 64;
+  int nb_sets = 1 + DEX_NB_TYPES + DEX_NB_GENERATIONS + 2;
+  size_t sets_size = (size_t)nb_sets * words * sizeof(uint64_t);
+  size_t columns_size = (size_t)count * (2 + 1 + 1 + 6);
+
+  // The bitsets come first to keep them aligned
+  char *block = mem_calloc(1, sets_size + columns_size);
+  if (block == NULL)
+    return 1;
+
+  uint64_t *set = (uint64_t *)block;
+  index->all = set;
+  for (int i = 0; i < DEX_NB_TYPES; i++)
+    index->type_sets[i] = set += words;
+  for (int i = 0; i < DEX_NB_GENERATIONS; i++)
+    index->gen_sets[i] = set += words;
+  index->legendary = set += words;
+  index->mythical = set += words;
+
+  uint8_t *column = (uint8_t *)(block + sets_size);
+  index->types = column;
+  index->gens = column += 2 * count;
+  index->flags = column += count;
+  index->stats = column += count;
+
+  index->block = block;
+  index->count = count;
+  index->words = words;
+  return 0;
+}
+
+/**
+ * @brief Fill the bitsets from the columns.
+ */
+static void dex_build_sets(struct DexIndex *index) {
+  for (int i = 0; i < index->count; i++) {
+    uint64_t bit = 1ULL << (i % 64);
+    int word = i / 64;
+
+    index->all[word] |= bit;
+    for (int t = 0; t < 2; t++) {
+      uint8_t type = index->types[2 * i + t];
+      if (type < DEX_NB_TYPES)
+        index->type_sets[type][word] |= bit;
+    }
+    uint8_t gen = index->gens[i];
+    if (gen >= 1 && gen <= DEX_NB_GENERATIONS)
+      index->gen_sets[gen - 1][word] |= bit;
+    if (index->flags[i] & DEX_LEGENDARY)
+      index->legendary[word] |= bit;
+    if (index->flags[i] & DEX_MYTHICAL)
+      index->mythical[word] |= bit;
+  }
+}
+
+/**
+ * @brief Read `index.bin`.
+ *
+ * @return 0 if the file was read, otherwise 1
+ */
+static int dex_read(struct DexIndex *index, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return 1;
+
+  unsigned char header[8];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+      memcmp(header, INDEX_MAGIC, 4) != 0 || header[4] != INDEX_VERSION) {
+    fprintf(stderr, "Error in dex.c: %s is not a valid index.\n", path);
+    fclose(file);
+    return 1;
+  }
+  int count = header[6] | header[7] << 8;
+  if (dex_alloc(index, count) != 0) {
+    fclose(file);
+    return 1;
+  }
+
+  // The columns follow each other in the file as in memory
+  size_t size = (size_t)count * (2 + 1 + 1 + 6);
+  if (fread(index->types, 1, size, file) != size) {
+    fprintf(stderr, "Error in dex.c: %s is truncated.\n", path);
+    fclose(file);
+    dex_free(index);
+    return 1;
+  }
+  fclose(file);
+  index->has_types = 1;
+  return 0;
+}
+
+int dex_load(struct DexIndex *index, const char *data_dir, int count) {
+  char path[512];
+  memset(index, 0, sizeof(*index));
+  snprintf(path, sizeof(path), "%s/index.bin", data_dir);
+
+  if (dex_read(index, path) != 0) {
+    // Only the generations are known without the index
+    if (count <= 0 || dex_alloc(index, count) != 0)
+      return 1;
+    memset(index->types, 0xFF, 2 * count);
+    int gen = 0;
+    for (int i = 0; i < count; i++) {
+      while (gen < DEX_NB_GENERATIONS - 1 && i + 1 > gen_last_id[gen])
+        gen++;
+      index->gens[i] = gen + 1;
+    }
+  }
+  dex_build_sets(index);
+  return 0;
+}
+
+void dex_free(struct DexIndex *index) {
+  mem_free(index->block);
+  memset(index, 0, sizeof(*index));
+}
+
+void dex_row(const struct DexIndex *index, int id, struct DexRow *row) {
+  int i = id - 1;
+  memcpy(row->types, index->types + 2 * i, 2);
+  row->gen = index->gens[i];
+  row->flags = index->flags[i];
+  memcpy(row->stats, index->stats + 6 * i, 6);
+}
+
+int dex_write(const char *path, const struct DexRow *rows, int count) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL)
+    return 1;
+
+  unsigned char header[8] = {0, 0, 0, 0, INDEX_VERSION, 0, count & 0xFF,
+                             count >> 8};
+  memcpy(header, INDEX_MAGIC, 4);
+  fwrite(header, 1, sizeof(header), file);
+  // One column after the other, see `dex_read()`
+  for (int i = 0; i < count; i++)
+    fwrite(rows[i].types, 1, 2, file);
+  for (int i = 0; i < count; i++)
+    fputc(rows[i].gen, file);
+  for (int i = 0; i < count; i++)
+    fputc(rows[i].flags, file);
+  for (int i = 0; i < count; i++)
+    fwrite(rows[i].stats, 1, 6, file);
+  int error = ferror(file);
+  return fclose(file) != 0 || error;
+}
+
+/**
+ * @brief Compute the bitset of the species matching a filter.
+ *
+ * @param set Where the bitset is stored, `index->words` words
+ * @return The number of species in the bitset
+ */
+static int dex_filter(const struct DexIndex *index,
+                      const struct DexFilter *filter, uint64_t *set) {
+  int count = 0;
+  for (int w = 0; w < index->words; w++) {
+    uint64_t word = index->all[w];
+    for (int t = 0; t < DEX_NB_TYPES; t++) {
+      if (filter->types & (1u << t))
+        word &= index->type_sets[t][w];
+    }
+    if (filter->gens) {
+      uint64_t gens = 0;
+      for (int g = 0; g < DEX_NB_GENERATIONS; g++) {
+        if (filter->gens & (1u << g))
+          gens |= index->gen_sets[g][w];
+      }
+      word &= gens;
+    }
+    // The rarity flags are alternatives, like the generations
+    if (filter->legendary || filter->mythical) {
+      uint64_t rare = 0;
+      if (filter->legendary)
+        rare |= index->legendary[w];
+      if (filter->mythical)
+        rare |= index->mythical[w];
+      word &= rare;
+    }
+    set[w] = word;
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+
+int dex_count(const struct DexIndex *index, const struct DexFilter *filter) {
+  if (index->words == 0)
+    return 0;
+  uint64_t set[index->words];
+  return dex_filter(index, filter, set);
+}
+
+int dex_pick(const struct DexIndex *index, const struct DexFilter *filter,
+             uint64_t random) {
+  if (index->words == 0)
+    return 0;
+  uint64_t set[index->words];
+  int count = dex_filter(index, filter, set);
+  if (count == 0)
+    return 0;
+
+  // Find the word holding the n-th species, then the bit in the word
+  int nth = random % count;
+  for (int w = 0; w < index->words; w++) {
+    int bits = __builtin_popcountll(set[w]);
+    if (nth >= bits) {
+      nth -= bits;
+      continue;
+    }
+    uint64_t word = set[w];
+    while (nth-- > 0)
+      word &= word - 1; // Clear the lowest bit
+    return w * 64 + __builtin_ctzll(word) + 1;
+  }
+  return 0;
+}
+
+int dex_select(const struct DexIndex *index, const struct DexFilter *filter,
+               int *ids, int max) {
+  if (index->words == 0)
+    return 0;
+  uint64_t set[index->words];
+  dex_filter(index, filter, set);
+
+  int nb = 0;
+  for (int w = 0; w < index->words && nb < max; w++) {
+    uint64_t word = set[w];
+    while (word && nb < max) {
+      ids[nb++] = w * 64 + __builtin_ctzll(word) + 1;
+      word &= word - 1;
+    }
+  }
+  return nb;
+}
@@ -2,11 +2,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 
 #include "../include/pokemon.h"
+#include "../include/color.h"
 #include "../include/display.h"
+#include "../include/memstats.h"
 
-size_t raw_text_size(const char *text) {
+static size_t raw_text_size(const char *text) {
   size_t size = 0;
   while (*text) {
     if (*text == '\033') { // Start of ANSI escape sequence
@@ -16,64 +19,81 @@ size_t raw_text_size(const char *text) {
       if (*text)
         text++; // Skip the final letter of the escape sequence
     } else {
-      size++;
+      // Only count the first byte of each UTF-8 character
+      if ((*text & 0xC0) != 0x80)
+        size++;
       text++;
     }
   }
   return size;
 }
 
-char *format_title(int id, char *name, char *genus, char *shiny) {
+/**
+ * @brief Number of UTF-8 characters in the first `len` bytes of a text.
+ */
+static size_t raw_text_size_n(const char *text, size_t len) {
+  size_t size = 0;
+  for (size_t i = 0; i < len; i++) {
+    if ((text[i] & 0xC0) != 0x80)
+      size++;
+  }
+  return size;
+}
+
+static char *format_title(int id, char *name, char *genus, char *shiny,
+                          enum ColorMode mode) {
   char *result = NOT_FOUND;
 
-  char *bg;
-  char *color;
+  char bg[64];
+  char fg[32];
+  char color[32];
   char p_id[7];
   char *text;
+  const char *reset = mode == COLOR_NONE ? "" : DEFAULT;
 
   int size;
 
   // Background color for ID
-  size = strlen(BG) + strlen(WHITE) + strlen(FG) + strlen(BLACK) + 1;
-  bg = malloc(sizeof(char) * size);
-  snprintf(bg, size, "%s%s%s%s", BG, WHITE, FG, BLACK);
+  size = format_color(bg, sizeof(bg), mode, BG, WHITE);
+  format_color(fg, sizeof(fg), mode, FG, BLACK);
+  strncat(bg, fg, sizeof(bg) - size - 1);
 
   // Color for shiny
   if (strcmp(shiny, "shiny") == 0) {
-    size = strlen(FG) + strlen(ELECTRIC) + 1;
-    color = malloc(sizeof(char) * size);
-    snprintf(color, size, "%s%s", FG, ELECTRIC);
+    format_color(color, sizeof(color), mode, FG, ELECTRIC);
   } else {
-    color = "\0";
+    color[0] = '\0';
   }
 
   // Create text for ID
   snprintf(p_id, sizeof(p_id), " %04d ", id);
 
-  // Create text for name and genus
-  size = 1 + strlen(name) + 3 + strlen(genus) +
+  // Create text for name and genus, either may be hidden (NULL)
+  size = 1 + (name ? strlen(name) : 0) + 3 + (genus ? strlen(genus) : 0) +
          1; // +5 for the spaces and the '\0'
-  text = malloc(sizeof(char) * size);
-  snprintf(text, size, " %s - %s", name, genus);
+  text = mem_malloc(sizeof(char) * size);
+  if (name && genus) {
+    snprintf(text, size, " %s - %s", name, genus);
+  } else if (name || genus) {
+    snprintf(text, size, " %s", name ? name : genus);
+  } else {
+    text[0] = '\0';
+  }
 
   // Store result
-  size = strlen(bg) + strlen(p_id) + 2 * strlen(DEFAULT) + strlen(color) +
+  size = strlen(bg) + strlen(p_id) + 2 * strlen(reset) + strlen(color) +
          strlen(text) + 3;
-  result = malloc(sizeof(char) * size);
-  snprintf(result, size, " %s%s%s%s%s%s ", bg, p_id, DEFAULT, color, text,
-           DEFAULT);
+  result = mem_malloc(sizeof(char) * size);
+  snprintf(result, size, " %s%s%s%s%s%s ", bg, p_id, reset, color, text,
+           reset);
 
   // Free everything
-  free(bg);
-  if (strcmp(shiny, "shiny") == 0) {
-    free(color);
-  }
-  free(text);
+  mem_free(text);
 
   return result;
 }
 
-char *type_color(char *type) {
+static char *type_color(char *type) {
   char *result;
   // Define the type mappings to match the names with the colors
   struct TypeMapping {
@@ -102,8 +122,8 @@ char *type_color(char *type) {
   return result;
 }
 
-char *spaces(size_t size, char *text) {
-  char *space = malloc(sizeof(char) * (size + 1));
+static char *spaces(size_t size, char *text) {
+  char *space = mem_malloc(sizeof(char) * (size + 1));
   if (!space)
     return NULL; // always check malloc
 
@@ -113,21 +133,24 @@ char *spaces(size_t size, char *text) {
   space[size] = '\0';
 
   size_t new_size = strlen(space) + strlen(text) + 1;
-  char *result = malloc(sizeof(char) * new_size);
+  char *result = mem_malloc(sizeof(char) * new_size);
   if (!result) {
-    free(space);
+    mem_free(space);
     return NULL;
   }
 
   snprintf(result, new_size, "%s%s", space, text);
-  free(space);
+  mem_free(space);
 
   return result;
 }
 
-char *format_types(size_t max_size, char *types[2]) {
+static char *format_types(size_t max_size, char *types[2],
+                          enum ColorMode mode) {
   char *result = NOT_FOUND;
-  char *color, *text[2], *bg;
+  char *color, *text[2];
+  char bg[32];
+  const char *reset = mode == COLOR_NONE ? "" : DEFAULT;
   size_t size, spaces_size;
 
   for (int i = 0; i < 2; i++) {
@@ -136,81 +159,295 @@ char *format_types(size_t max_size, char *types[2]) {
       color = type_color(types[i]);
 
       // Create background color
-      size = strlen(BG) + strlen(color) + 1;
-      bg = malloc(sizeof(char) * size);
-      snprintf(bg, size, "%s%s", BG, color);
+      format_color(bg, sizeof(bg), mode, BG, color);
 
       // Create text for the type
-      size = strlen(bg) + strlen(types[i]) + strlen(DEFAULT) + 5;
-      text[i] = malloc(sizeof(char) * size);
-      snprintf(text[i], size, " %s %s %s ", bg, types[i], DEFAULT);
-
-      // Free everything
-      free(bg);
+      size = strlen(bg) + strlen(types[i]) + strlen(reset) + 5;
+      text[i] = mem_malloc(sizeof(char) * size);
+      snprintf(text[i], size, " %s %s %s ", bg, types[i], reset);
     } else {
       text[i] = "";
     }
   }
 
   // Create the result string
-  size = strlen(text[0]) + strlen(text[1]) + strlen(DEFAULT) + 1;
-  if (strcmp(types[1], NOT_FOUND) == 0) {
-    size += 4; // For the spaces
-  }
+  size = strlen(text[0]) + strlen(text[1]) + strlen(reset) + 1;
+  size += 4; // For the spaces
 
-  result = malloc(sizeof(char) * size);
+  result = mem_malloc(sizeof(char) * size);
   if (strcmp(types[1], NOT_FOUND) == 0) {
-    snprintf(result, size, "%s%s", text[0], DEFAULT);
+    snprintf(result, size, "%s%s", text[0], reset);
   } else {
-    snprintf(result, size, "%s    %s%s", text[0], text[1], DEFAULT);
+    snprintf(result, size, "%s    %s%s", text[0], text[1], reset);
   }
   // Add spaces to center the result
-  spaces_size = (max_size - raw_text_size(result)) / 2;
+  // Types wider than the title are not centered
+  spaces_size = 0;
+  if (raw_text_size(result) < max_size)
+    spaces_size = (max_size - raw_text_size(result)) / 2;
   char *spaces_result = spaces(spaces_size, result);
-  free(result);
-  result = malloc(sizeof(char) * (strlen(spaces_result) + 1));
+  mem_free(result);
+  result = mem_malloc(sizeof(char) * (strlen(spaces_result) + 1));
   snprintf(result, strlen(spaces_result) + 1, "%s", spaces_result);
-  free(spaces_result);
+  mem_free(spaces_result);
 
   // Free the text strings
   for (int i = 0; i < 2; i++) {
     if (strcmp(types[i], NOT_FOUND) != 0) {
-      free(text[i]);
+      mem_free(text[i]);
     }
   }
 
   return result;
 }
 
-int format_desc(char *desc);
+/**
+ * @brief Split the description in lines of at most `width` characters.
+ *
+ * Lines are cut on spaces and indented like the other lines of the card.
+ *
+ * @param desc Description of the pokémon
+ * @param width Maximum number of characters of a line
+ * @param lines Where the lines are stored, they point in the returned buffer
+ * @param nb_lines Number of lines stored, at most `max`
+ * @param max Size of `lines`
+ * @return A dynamically allocated buffer holding the lines, or `NULL`
+ */
+static char *format_desc(const char *desc, size_t width, char *lines[],
+                         int *nb_lines, int max) {
+  // Each line is at most one space and a '\0' longer than its text
+  char *result = mem_malloc(2 * strlen(desc) + 2);
+  if (result == NULL)
+    return NULL;
+
+  char *out = result;
+  size_t used = 0;
+  *nb_lines = 0;
+  while (*desc) {
+    while (*desc == ' ')
+      desc++;
+    size_t len = strcspn(desc, " ");
+    size_t chars = raw_text_size_n(desc, len);
+    if (len == 0)
+      break;
+
+    if (*nb_lines == 0 || used + 1 + chars > width) {
+      if (*nb_lines == max)
+        break;
+      if (*nb_lines > 0)
+        *out++ = '\0';
+      lines[(*nb_lines)++] = out;
+      used = 0;
+    }
+    *out++ = ' ';
+    memcpy(out, desc, len);
+    out += len;
+    used += 1 + chars;
+    desc += len;
+  }
+  *out = '\0';
+  return result;
+}
+
+/**
+ * @brief Print the icon on the left and the lines of information on its right.
+ *
+ * The information is centered vertically on the icon.
+ */
+static void print_card(FILE *out, char *icon, char *lines[], int nb_lines) {
+  char *icon_lines[128];
+  int nb_icon = 0;
+  size_t width = 0;
+
+  // Split the icon in lines
+  if (icon && strcmp(icon, NOT_FOUND) != 0) {
+    char *save;
+    char *line = strtok_r(icon, "\n", &save);
+    while (line && nb_icon < 128) {
+      icon_lines[nb_icon++] = line;
+      size_t line_width = raw_text_size(line);
+      if (line_width > width)
+        width = line_width;
+      line = strtok_r(NULL, "\n", &save);
+    }
+  }
 
-int display(struct Pokemon *pokemon, char *shiny) {
-  char imagePath[512];
-  snprintf(imagePath, sizeof(imagePath), "%s/%s/%s", "assets/icons", shiny,
-           pokemon->alias);
+  int total = nb_icon > nb_lines ? nb_icon : nb_lines;
+  int offset = (total - nb_lines) / 2;
+  for (int i = 0; i < total; i++) {
+    size_t used = 0;
+    if (i < nb_icon) {
+      fputs(icon_lines[i], out);
+      used = raw_text_size(icon_lines[i]);
+    }
+    int info = i - offset;
+    if (info >= 0 && info < nb_lines) {
+      fprintf(out, "%*s%s", (int)(width - used), "", lines[info]);
+    }
+    fputc('\n', out);
+  }
+}
 
-  // Image of the pokémon
-  // char *image = fetch_icon(imagePath, pokemon->alias, 0);
+int display(FILE *out, struct Pokemon *pokemon, char *shiny,
+            enum ColorMode mode, unsigned fields) {
+  char *lines[32];
+  int nb_lines = 0;
 
-  char *title = format_title(pokemon->id, pokemon->name, pokemon->genus, shiny);
+  char *title = format_title(pokemon->id,
+                             (fields & FIELD_NAME) ? pokemon->name : NULL,
+                             (fields & FIELD_GENUS) ? pokemon->genus : NULL,
+                             shiny, mode);
   if (strcmp(title, NOT_FOUND) == 0) {
     fprintf(stderr, "Error in display.c: Failed to format title.\n");
     return 1;
   }
   size_t title_size = raw_text_size(title);
-  printf("%s\n", title);
+  lines[nb_lines++] = title;
+
+  char *types = NOT_FOUND;
+  if (fields & FIELD_TYPES) {
+    types = format_types(title_size, pokemon->types, mode);
+    if (strcmp(types, NOT_FOUND) == 0) {
+      fprintf(stderr, "Error in display.c: Failed to format types.\n");
+      mem_free(title);
+      return 1;
+    }
+    lines[nb_lines++] = types;
+  }
 
-  char *types = format_types(title_size, pokemon->types);
-  if (strcmp(types, NOT_FOUND) == 0) {
-    fprintf(stderr, "Error in display.c: Failed to format types.\n");
-    free(title);
-    return 1;
+  // Height and weight are given by the PokéAPI in decimeters and hectograms
+  char size[64] = "";
+  if (fields & (FIELD_HEIGHT | FIELD_WEIGHT)) {
+    int len = 0;
+    if (fields & FIELD_HEIGHT)
+      len += snprintf(size + len, sizeof(size) - len, " %d.%d m",
+                      pokemon->height / 10, pokemon->height % 10);
+    if (fields & FIELD_WEIGHT)
+      snprintf(size + len, sizeof(size) - len, " %d.%d kg",
+               pokemon->weight / 10, pokemon->weight % 10);
+    lines[nb_lines++] = size;
+  }
+
+  char stats[128];
+  if (fields & FIELD_STATS) {
+    int *s = pokemon->stats;
+    snprintf(stats, sizeof(stats),
+             " HP %d  Atk %d  Def %d  SpA %d  SpD %d  Spe %d", s[0], s[1], s[2],
+             s[3], s[4], s[5]);
+    lines[nb_lines++] = stats;
+  }
+
+  char abilities[512];
+  if (fields & FIELD_ABILITIES) {
+    snprintf(abilities, sizeof(abilities), " %s", pokemon->abilities);
+    lines[nb_lines++] = abilities;
+  }
+
+  char *desc = NULL;
+  if ((fields & FIELD_DESC) && strcmp(pokemon->desc, NOT_FOUND) != 0) {
+    int nb_desc = 0;
+    size_t width = title_size > 40 ? title_size : 40;
+    desc = format_desc(pokemon->desc, width, lines + nb_lines, &nb_desc,
+                       32 - nb_lines);
+    nb_lines += nb_desc;
   }
-  printf("%s\n", types);
+
+  print_card(out, (fields & FIELD_ICON) ? pokemon->icon : NOT_FOUND, lines,
+             nb_lines);
 
   // Free the memory allocated
-  free(title);
-  free(types);
+  mem_free(title);
+  if (fields & FIELD_TYPES)
+    mem_free(types);
+  mem_free(desc);
+
+  return 0;
+}
+
+int display_evolutions(FILE *out, struct Evolution *members, int size,
+                       int current, enum ColorMode mode) {
+  char *lines[MAX_EVOLUTIONS][128];
+  int nb_lines[MAX_EVOLUTIONS];
+  size_t widths[MAX_EVOLUTIONS];
+  int height = 0;
+  int max_stage = 0;
+
+  if (size > MAX_EVOLUTIONS)
+    size = MAX_EVOLUTIONS;
+
+  // Split every icon in lines
+  for (int i = 0; i < size; i++) {
+    nb_lines[i] = 0;
+    widths[i] = 0;
+    if (members[i].stage > max_stage)
+      max_stage = members[i].stage;
+    if (strcmp(members[i].icon, NOT_FOUND) == 0)
+      continue;
+
+    char *save;
+    char *line = strtok_r(members[i].icon, "\n", &save);
+    while (line && nb_lines[i] < 128) {
+      lines[i][nb_lines[i]++] = line;
+      size_t width = raw_text_size(line);
+      if (width > widths[i])
+        widths[i] = width;
+      line = strtok_r(NULL, "\n", &save);
+    }
+    if (nb_lines[i] > height)
+      height = nb_lines[i];
+  }
+
+  // Icons side by side, aligned on their bottom line
+  for (int y = 0; y < height; y++) {
+    for (int i = 0; i < size; i++) {
+      int index = y - (height - nb_lines[i]);
+      size_t used = 0;
+      if (index >= 0) {
+        fputs(lines[i][index], out);
+        used = raw_text_size(lines[i][index]);
+      }
+      fprintf(out, "%*s", (int)(widths[i] - used), "");
+    }
+    fputc('\n', out);
+  }
+
+  // Names of the line, grouped by stage
+  const char *bold = mode == COLOR_NONE ? "" : "\033[1m";
+  const char *reset = mode == COLOR_NONE ? "" : DEFAULT;
+  fputc(' ', out);
+  for (int stage = 0; stage <= max_stage; stage++) {
+    int first = 1;
+    if (stage > 0)
+      fputs(" > ", out);
+    for (int i = 0; i < size; i++) {
+      if (members[i].stage != stage)
+        continue;
+      if (!first)
+        fputs(" / ", out);
+      if (members[i].id == current)
+        fprintf(out, "%s%s%s", bold, members[i].name, reset);
+      else
+        fputs(members[i].name, out);
+      first = 0;
+    }
+  }
+  fputc('\n', out);
 
   return 0;
 }
+
+int terminal_size(int fd, int *columns, int *rows) {
+  struct winsize ws;
+  if (ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+    *columns = ws.ws_col;
+    *rows = ws.ws_row;
+    return 0;
+  }
+
+  // Not a terminal (e.g., a pipe), the shell may still know the size
+  const char *env_columns = getenv("COLUMNS");
+  const char *env_rows = getenv("LINES");
+  *columns = env_columns && atoi(env_columns) > 0 ? atoi(env_columns) : 0;
+  *rows = env_rows && atoi(env_rows) > 0 ? atoi(env_rows) : 0;
+  return *columns == 0 && *rows == 0;
+}
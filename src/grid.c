@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/context.h"
+#include "../include/grid.h"
+#include "../include/parser.h"
+#include "../include/memstats.h"
+
+#define CAPTION_SIZE 64
+
+/**
+ * @struct GridLine
+ * @brief A line of an icon, without its newline.
+ */
+struct GridLine {
+  size_t offset; /**< Offset of the line in the text of the icon */
+  size_t length; /**< Length of the line, in bytes */
+  int width;     /**< Width of the line, in columns */
+};
+
+/**
+ * @struct GridIcon
+ * @brief An icon of the grid, indexed by line.
+ */
+struct GridIcon {
+  char *text;                    /**< Icon, as loaded from the local data */
+  struct GridLine *lines;        /**< Index of the lines of the icon */
+  int nb_lines;                  /**< Number of lines */
+  int width;                     /**< Width of the widest line */
+  char caption[CAPTION_SIZE];    /**< ID and name of the pokémon */
+  int caption_length;            /**< Length of the caption, in bytes */
+  int caption_width;             /**< Width of the caption, in columns */
+};
+
+/**
+ * @brief Check whether a byte starts a character in UTF-8.
+ */
+static int is_lead_byte(char c) {
+  return ((unsigned char)c & 0xC0) != 0x80;
+}
+
+/**
+ * @brief Index the lines of an icon in one pass over its text.
+ *
+ * Escape sequences do not take any column, every other character takes one.
+ *
+ * @return 0 if the index was built, otherwise 1
+ */
+static int index_icon(struct GridIcon *icon) {
+  int capacity = 0;
+  const char *text = icon->text;
+  size_t start = 0;
+  int width = 0;
+
+  for (size_t i = 0;; i++) {
+    char c = text[i];
+    if (c != '\n' && c != '\0') {
+      if (c == '\033') {
+        // Skip the escape sequence
+        while (text[i + 1] && text[i] != 'm')
+          i++;
+      } else if (is_lead_byte(c)) {
+        width++;
+      }
+      continue;
+    }
+
+    // A trailing newline does not start an empty line
+    if (c == '\0' && i == start)
+      break;
+    if (icon->nb_lines == capacity) {
+      capacity = capacity ? capacity * 2 : 32;
+      struct GridLine *ptr = mem_realloc(icon->lines, capacity * sizeof(*ptr));
+      if (ptr == NULL)
+        return 1;
+      icon->lines = ptr;
+    }
+    icon->lines[icon->nb_lines++] = (struct GridLine){start, i - start, width};
+    if (width > icon->width)
+      icon->width = width;
+
+    if (c == '\0')
+      break;
+    start = i + 1;
+    width = 0;
+  }
+  return 0;
+}
+
+/**
+ * @brief Load and index the icon of a pokémon, with its caption.
+ */
+static void load_grid_icon(struct Pokefetch *ctx, struct GridIcon *icon,
+                           int id, struct GridOptions *options) {
+  struct Pokemon pokemon = {NOT_FOUND, NOT_FOUND, id, {NOT_FOUND, NOT_FOUND},
+    0, 0, NOT_FOUND, NOT_FOUND, NOT_FOUND, {0}, NOT_FOUND};
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  parse_local_pokemon(ctx, &pokemon, id, options->lang, FIELD_NAME);
+
+  memset(icon, 0, sizeof(*icon));
+  // At least one cell per row, icons are scaled down in small terminals
+  mem_phase(MEM_ICON);
+  icon->text = load_colored_icon(ctx->data_dir, options->shiny, pokemon.alias,
+                                 options->mode,
+                                 options->width > 1 ? options->width - 1 : 1,
+                                 0);
+  mem_phase(phase);
+  if (strcmp(icon->text, NOT_FOUND) == 0 || index_icon(icon) != 0)
+    icon->nb_lines = 0;
+
+  icon->caption_length = snprintf(icon->caption, CAPTION_SIZE, "#%d %s", id,
+                                  strcmp(pokemon.name, NOT_FOUND) != 0
+                                      ? pokemon.name
+                                      : "");
+  if (icon->caption_length >= CAPTION_SIZE)
+    icon->caption_length = CAPTION_SIZE - 1;
+  for (int i = 0; i < icon->caption_length; i++)
+    icon->caption_width += is_lead_byte(icon->caption[i]);
+  free_pokemon(&pokemon);
+}
+
+static void free_grid_icon(struct GridIcon *icon) {
+  if (strcmp(icon->text, NOT_FOUND) != 0)
+    mem_free(icon->text);
+  mem_free(icon->lines);
+}
+
+/**
+ * @brief Cut a caption to a number of columns, on a character boundary.
+ */
+static void fit_caption(struct GridIcon *icon, int columns) {
+  int width = 0;
+  for (int i = 0; i < icon->caption_length; i++) {
+    if (!is_lead_byte(icon->caption[i]))
+      continue;
+    if (width == columns) {
+      icon->caption_length = i;
+      break;
+    }
+    width++;
+  }
+  if (icon->caption_width > columns)
+    icon->caption_width = columns;
+}
+
+/**
+ * @brief Write a row of icons side by side, then their captions.
+ *
+ * The icons are aligned on their bottom line and every cell is padded to
+ * `cell` columns.
+ *
+ * @param buf Where the row is written, large enough (see `row_size()`)
+ * @return The number of bytes written
+ */
+static size_t write_row(char *buf, struct GridIcon *icons, int nb, int cell) {
+  char *write = buf;
+  int height = 0;
+  for (int i = 0; i < nb; i++) {
+    if (icons[i].nb_lines > height)
+      height = icons[i].nb_lines;
+  }
+
+  for (int y = 0; y < height; y++) {
+    for (int i = 0; i < nb; i++) {
+      int index = y - (height - icons[i].nb_lines);
+      int used = 0;
+      if (index >= 0) {
+        struct GridLine *line = &icons[i].lines[index];
+        memcpy(write, icons[i].text + line->offset, line->length);
+        write += line->length;
+        used = line->width;
+      }
+      // The last cell of the line needs no padding
+      if (i < nb - 1) {
+        memset(write, ' ', cell - used);
+        write += cell - used;
+      }
+    }
+    *write++ = '\n';
+  }
+
+  for (int i = 0; i < nb; i++) {
+    memcpy(write, icons[i].caption, icons[i].caption_length);
+    write += icons[i].caption_length;
+    if (i < nb - 1) {
+      memset(write, ' ', cell - icons[i].caption_width);
+      write += cell - icons[i].caption_width;
+    }
+  }
+  *write++ = '\n';
+  return write - buf;
+}
+
+/**
+ * @brief Upper bound of the size of a row written by `write_row()`.
+ */
+static size_t row_size(struct GridIcon *icons, int nb, int cell) {
+  int height = 0;
+  size_t size = 0;
+  for (int i = 0; i < nb; i++) {
+    if (icons[i].nb_lines > height)
+      height = icons[i].nb_lines;
+    for (int y = 0; y < icons[i].nb_lines; y++)
+      size += icons[i].lines[y].length;
+    size += icons[i].caption_length;
+  }
+  // Padding and newlines, as if every cell were empty
+  return size + (size_t)(height + 1) * (nb * cell + 1);
+}
+
+int show_grid(struct Pokefetch *ctx, const int *ids, int nb_ids,
+              struct GridOptions *options, FILE *out) {
+  if (nb_ids <= 0)
+    return 1;
+  struct GridIcon *icons = mem_calloc(nb_ids, sizeof(*icons));
+  if (icons == NULL)
+    return 1;
+
+  // Every cell is as wide as the widest icon, with a column between cells
+  int cell = 0;
+  for (int i = 0; i < nb_ids; i++) {
+    load_grid_icon(ctx, &icons[i], ids[i], options);
+    if (icons[i].width > cell)
+      cell = icons[i].width;
+  }
+  cell += 1;
+  if (cell < 12)
+    cell = 12;
+  int columns = options->width / cell;
+  if (columns < 1)
+    columns = 1;
+  for (int i = 0; i < nb_ids; i++)
+    fit_caption(&icons[i], cell - 1);
+
+  // The whole grid is composed in one buffer, written at once
+  size_t size = 0;
+  for (int i = 0; i < nb_ids; i += columns) {
+    int nb = nb_ids - i < columns ? nb_ids - i : columns;
+    size += row_size(icons + i, nb, cell);
+  }
+  char *buf = mem_malloc(size);
+  int status = 1;
+  if (buf != NULL) {
+    size_t len = 0;
+    for (int i = 0; i < nb_ids; i += columns) {
+      int nb = nb_ids - i < columns ? nb_ids - i : columns;
+      len += write_row(buf + len, icons + i, nb, cell);
+    }
+    status = fwrite(buf, 1, len, out) == len ? 0 : 1;
+    fflush(out);
+  } else {
+    fprintf(stderr, "Error in grid.c: Failed to allocate the grid.\n");
+  }
+
+  mem_free(buf);
+  for (int i = 0; i < nb_ids; i++)
+    free_grid_icon(&icons[i]);
+  mem_free(icons);
+  return status;
+}
+
+int parse_team(const char *str, int *ids, int max) {
+  int nb = 0;
+  if (str == NULL)
+    return -1;
+  while (*str) {
+    char *end;
+    long id = strtol(str, &end, 10);
+    if (end == str || id < 1 || nb == max)
+      return -1;
+    ids[nb++] = (int)id;
+    str = end;
+    if (*str == ',')
+      str++;
+    else if (*str)
+      return -1;
+  }
+  return nb;
+}
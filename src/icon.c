@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/icon.h"
+#include "../include/memstats.h"
+
+#define UPPER_HALF "▀"
+#define LOWER_HALF "▄"
+#define RESET "\033[0m"
+
+/**
+ * @struct CellColor
+ * @brief Escape sequences of a color of the palette, formatted once.
+ */
+struct CellColor {
+  char fg[24];   /**< Foreground sequence */
+  char bg[24];   /**< Background sequence */
+  int fg_len;    /**< Length of `fg` */
+  int bg_len;    /**< Length of `bg` */
+};
+
+static int read_u16(const unsigned char *data) {
+  return data[0] | data[1] << 8;
+}
+
+/**
+ * @brief Write a cell of the icon, as `convert_to_text()` in get_icons.py.
+ *
+ * @return The number of bytes written
+ */
+static size_t write_cell(char *buf, const struct CellColor *colors, int top,
+                         int bottom, const char *reset, size_t reset_len) {
+  char *write = buf;
+  if (top == 0 && bottom == 0) {
+    *write++ = ' ';
+    return 1;
+  }
+  if (top == 0) {
+    memcpy(write, colors[bottom].fg, colors[bottom].fg_len);
+    write += colors[bottom].fg_len;
+    memcpy(write, LOWER_HALF, strlen(LOWER_HALF));
+    write += strlen(LOWER_HALF);
+  } else {
+    memcpy(write, colors[top].fg, colors[top].fg_len);
+    write += colors[top].fg_len;
+    if (bottom != 0) {
+      memcpy(write, colors[bottom].bg, colors[bottom].bg_len);
+      write += colors[bottom].bg_len;
+    }
+    memcpy(write, UPPER_HALF, strlen(UPPER_HALF));
+    write += strlen(UPPER_HALF);
+  }
+  memcpy(write, reset, reset_len);
+  return write - buf + reset_len;
+}
+
+char *decode_icon(const unsigned char *data, size_t size, enum ColorMode mode,
+                  int shiny) {
+  if (size < ICON_HEADER_SIZE || memcmp(data, ICON_MAGIC, 4) != 0)
+    return NULL;
+  int width = read_u16(data + 4);
+  int height = read_u16(data + 6);
+  int nb_colors = data[8];
+  // Without any cell, the runs would never reach the end of a line
+  if (width == 0 || height == 0)
+    return NULL;
+  const unsigned char *runs = data + ICON_HEADER_SIZE +
+                              (size_t)nb_colors * ICON_ENTRY_SIZE;
+  if (runs > data + size)
+    return NULL;
+  // Each run covers at most 255 cells, do not trust larger dimensions
+  if ((size_t)width * height > (size_t)(data + size - runs) / 3 * 255)
+    return NULL;
+
+  // Sequences of every color, index 0 being the transparent pixel
+  struct CellColor colors[256];
+  for (int i = 0; i < nb_colors; i++) {
+    const unsigned char *e = data + ICON_HEADER_SIZE + i * ICON_ENTRY_SIZE;
+    struct PaletteEntry entry = {e[0], e[1], e[2], e[3], e[4],
+                                 e[5], e[6], e[7], e[8], e[9]};
+    colors[i + 1].fg_len = format_entry(colors[i + 1].fg, mode, 0, &entry,
+                                        shiny);
+    colors[i + 1].bg_len = format_entry(colors[i + 1].bg, mode, 1, &entry,
+                                        shiny);
+  }
+  const char *reset = mode == COLOR_NONE ? "" : RESET;
+  size_t reset_len = strlen(reset);
+
+  // Worst case: two sequences, a half block and a reset per cell
+  size_t cell_size = 2 * sizeof(colors[0].fg) + strlen(UPPER_HALF) + reset_len;
+  char *result = mem_malloc((size_t)height * (width * cell_size + 1) + 1);
+  if (result == NULL)
+    return NULL;
+
+  char *write = result;
+  const unsigned char *read = runs;
+  int x = 0, y = 0;
+  while (y < height) {
+    if (read + 3 > data + size) {
+      mem_free(result);
+      return NULL;
+    }
+    int count = read[0];
+    int top = read[1];
+    int bottom = read[2];
+    read += 3;
+    if (count == 0 || top > nb_colors || bottom > nb_colors) {
+      mem_free(result);
+      return NULL;
+    }
+
+    // The first cell is formatted once, the rest of the run is copied
+    char *cell = write;
+    size_t cell_len = 0;
+    while (count-- > 0 && y < height) {
+      if (cell_len == 0) {
+        cell_len = write_cell(write, colors, top, bottom, reset, reset_len);
+      } else {
+        memcpy(write, cell, cell_len);
+      }
+      write += cell_len;
+      if (++x == width) {
+        *write++ = '\n';
+        x = 0;
+        y++;
+        // The next cell starts a new line, format it again
+        cell = write;
+        cell_len = 0;
+      }
+    }
+  }
+  *write = '\0';
+  return result;
+}
+
+int read_icon_size(const char *filename, int *width, int *height) {
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL)
+    return 1;
+
+  unsigned char header[ICON_HEADER_SIZE];
+  size_t size = fread(header, 1, sizeof(header), file);
+  fclose(file);
+  if (size != sizeof(header) || memcmp(header, ICON_MAGIC, 4) != 0)
+    return 1;
+  *width = read_u16(header + 4);
+  *height = read_u16(header + 6);
+  return 0;
+}
+
+char *load_packed_icon(const char *filename, enum ColorMode mode, int shiny) {
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL)
+    return NULL;
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  unsigned char *data = mem_malloc(size > 0 ? size : 1);
+  if (data == NULL || fread(data, 1, size, file) != (size_t)size) {
+    mem_free(data);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+
+  char *icon = decode_icon(data, size, mode, shiny);
+  if (icon == NULL)
+    fprintf(stderr, "Error in icon.c: %s is not a valid icon.\n", filename);
+  mem_free(data);
+  return icon;
+}
@@ -0,0 +1,554 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// personal files
+#include "../include/json.h"
+#include "../include/memstats.h"
+
+/**
+ * @enum Expect
+ * @brief What the tokenizer expects next.
+ */
+enum Expect {
+  EXPECT_VALUE, /**< A value, or the end of an empty array */
+  EXPECT_KEY,   /**< A key, or the end of an empty object */
+  EXPECT_COLON, /**< The colon after a key */
+  EXPECT_NEXT   /**< A comma or the end of the container */
+};
+
+static int is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/**
+ * @brief Find the end of a string.
+ *
+ * The quotes are looked for with `memchr()`, which goes through the long
+ * strings of PokéAPI (descriptions, URLs) much faster than a loop.
+ *
+ * @param pos Offset of the opening quote, set to the offset of the closing one
+ * @param escaped Set to 1 if the string holds escape sequences
+ * @return 0 if the string is valid, otherwise 1
+ */
+static int scan_string(const char *text, size_t size, size_t *pos,
+                       int *escaped) {
+  const char *start = text + *pos + 1;
+  const char *end = text + size;
+  const char *quote = start;
+  while (1) {
+    quote = memchr(quote, '"', end - quote);
+    if (quote == NULL)
+      return 1;
+    // An escaped quote follows an odd number of backslashes
+    const char *back = quote;
+    while (back > start && back[-1] == '\\')
+      back--;
+    if ((quote - back) % 2 == 0)
+      break;
+    quote++;
+  }
+  *escaped = memchr(start, '\\', quote - start) != NULL;
+  *pos = quote - text;
+  return 0;
+}
+
+/**
+ * @brief Find the end of a number or of a literal.
+ *
+ * @param pos Offset of the value, set to the offset after it
+ * @param type Where the type of the value is stored
+ * @return 0 if the value is valid, otherwise 1
+ */
+static int scan_scalar(const char *text, size_t size, size_t *pos,
+                       uint8_t *type) {
+  size_t i = *pos;
+  const char *literal;
+
+  switch (text[i]) {
+  case 'n':
+    literal = "null";
+    *type = JSON_NULL;
+    break;
+  case 'f':
+    literal = "false";
+    *type = JSON_FALSE;
+    break;
+  case 't':
+    literal = "true";
+    *type = JSON_TRUE;
+    break;
+  case '-':
+  case '0' ... '9':
+    i++;
+    while (i < size && ((text[i] >= '0' && text[i] <= '9') || text[i] == '.' ||
+                        text[i] == 'e' || text[i] == 'E' || text[i] == '+' ||
+                        text[i] == '-'))
+      i++;
+    *type = JSON_NUMBER;
+    *pos = i;
+    return 0;
+  default:
+    return 1;
+  }
+
+  size_t len = strlen(literal);
+  if (size - i < len || memcmp(text + i, literal, len) != 0)
+    return 1;
+  *pos = i + len;
+  return 0;
+}
+
+int json_tokenize(const char *text, size_t size, struct JsonToken *tokens,
+                  int max) {
+  int stack[JSON_MAX_DEPTH];  // Token of each open container
+  char kinds[JSON_MAX_DEPTH]; // Closing character of each open container
+  int depth = 0;
+  int count = 0;
+  enum Expect expect = EXPECT_VALUE;
+  size_t i = 0;
+
+  if (size >= UINT32_MAX)
+    return -1;
+
+  while (1) {
+    while (i < size && is_space(text[i]))
+      i++;
+    if (i >= size)
+      break;
+    char c = text[i];
+
+    if (depth > 0 && c == kinds[depth - 1] &&
+        (expect == EXPECT_NEXT || count == stack[depth - 1] + 1)) {
+      // End of a container, possibly empty
+      int container = stack[--depth];
+      if (container < max) {
+        tokens[container].len = i + 1 - tokens[container].start;
+        tokens[container].next = count;
+      }
+      i++;
+      expect = EXPECT_NEXT;
+      continue;
+    }
+    if (expect == EXPECT_NEXT) {
+      if (depth == 0 || c != ',')
+        return -1;
+      i++;
+      expect = kinds[depth - 1] == '}' ? EXPECT_KEY : EXPECT_VALUE;
+      continue;
+    }
+    if (expect == EXPECT_COLON) {
+      if (c != ':')
+        return -1;
+      i++;
+      expect = EXPECT_VALUE;
+      continue;
+    }
+    if (expect == EXPECT_KEY && c != '"')
+      return -1;
+
+    // A value or a key, each one is a token
+    struct JsonToken token = {i, 0, count + 1, JSON_NULL, 0};
+    if (c == '"') {
+      int escaped;
+      size_t end = i;
+      if (scan_string(text, size, &end, &escaped))
+        return -1;
+      token.start = i + 1;
+      token.len = end - i - 1;
+      token.type = JSON_STRING;
+      token.escaped = escaped;
+      i = end + 1;
+    } else if (c == '[' || c == '{') {
+      if (depth == JSON_MAX_DEPTH)
+        return -1;
+      token.type = c == '[' ? JSON_ARRAY : JSON_OBJECT;
+      kinds[depth] = c == '[' ? ']' : '}';
+      stack[depth++] = count;
+      i++;
+    } else {
+      size_t end = i;
+      if (scan_scalar(text, size, &end, &token.type))
+        return -1;
+      token.len = end - i;
+      i = end;
+    }
+    // Once the array is full, the tokens are only counted
+    if (count < max)
+      tokens[count] = token;
+    count++;
+
+    if (c == '[')
+      expect = EXPECT_VALUE;
+    else if (c == '{')
+      expect = EXPECT_KEY;
+    else if (expect == EXPECT_KEY)
+      expect = EXPECT_COLON;
+    else
+      expect = EXPECT_NEXT;
+    // Only one value at the top level
+    if (depth == 0 && expect == EXPECT_NEXT) {
+      while (i < size && is_space(text[i]))
+        i++;
+      if (i < size)
+        return -1;
+    }
+  }
+
+  if (depth > 0 || count == 0 || expect != EXPECT_NEXT)
+    return -1;
+  return count;
+}
+
+/**
+ * @struct Scratch
+ * @brief Tape reused by the documents of a thread, see `json_parse_temp()`.
+ */
+struct Scratch {
+  struct JsonToken *tokens; /**< Tape, as large as the largest document */
+  int max;                  /**< Size of `tokens` */
+  int busy;                 /**< 1 while a document uses the tape */
+};
+
+static _Thread_local struct Scratch scratch = {NULL, 0, 0};
+
+// Frees the tape of a thread when the thread exits
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+static void scratch_release(void *tokens) { mem_free(tokens); }
+
+static void scratch_init(void) {
+  pthread_key_create(&scratch_key, scratch_release);
+}
+
+/**
+ * @brief Tokenize a text in a tape, which grows as needed.
+ *
+ * @param tokens Tape, may be `NULL`
+ * @param max Size of the tape
+ * @return The number of tokens, or -1 if the text is invalid or the tape
+ * could not grow
+ */
+static int tokenize_tape(const char *text, size_t size,
+                         struct JsonToken **tokens, int *max) {
+  // PokéAPI documents hold a token every 8 bytes at most, so a single pass is
+  // usually enough, the tape is only tokenized again if the guess was short
+  int needed = size / 8 + 16;
+  while (1) {
+    if (needed > *max) {
+      struct JsonToken *ptr = mem_realloc(*tokens, needed * sizeof(*ptr));
+      if (ptr == NULL)
+        return -1;
+      *tokens = ptr;
+      *max = needed;
+    }
+    int count = json_tokenize(text, size, *tokens, *max);
+    if (count <= *max)
+      return count;
+    needed = count;
+  }
+}
+
+int json_parse(struct JsonDoc *doc, const char *text, size_t size) {
+  *doc = (struct JsonDoc){text, size, NULL, 0, NULL, 0};
+  int max = 0;
+  int count = tokenize_tape(text, size, &doc->tokens, &max);
+  if (count < 0) {
+    json_free(doc);
+    return 1;
+  }
+  doc->nb_tokens = count;
+  return 0;
+}
+
+int json_parse_temp(struct JsonDoc *doc, const char *text, size_t size) {
+  // Another document of the thread holds the tape, this one gets its own
+  if (scratch.busy)
+    return json_parse(doc, text, size);
+
+  *doc = (struct JsonDoc){text, size, NULL, 0, NULL, 0};
+  struct JsonToken *previous = scratch.tokens;
+  int count = tokenize_tape(text, size, &scratch.tokens, &scratch.max);
+  if (scratch.tokens != previous) {
+    pthread_once(&scratch_once, scratch_init);
+    pthread_setspecific(scratch_key, scratch.tokens);
+  }
+  if (count < 0)
+    return 1;
+  doc->tokens = scratch.tokens;
+  doc->nb_tokens = count;
+  doc->temp = 1;
+  scratch.busy = 1;
+  return 0;
+}
+
+void json_release(void) {
+  if (scratch.busy || scratch.tokens == NULL)
+    return;
+  pthread_setspecific(scratch_key, NULL);
+  mem_free(scratch.tokens);
+  scratch = (struct Scratch){NULL, 0, 0};
+}
+
+/**
+ * @brief Map a file and tokenize it with one of the parse functions.
+ */
+static int load(struct JsonDoc *doc, const char *filename,
+                int (*parse)(struct JsonDoc *, const char *, size_t)) {
+  *doc = (struct JsonDoc){NULL, 0, NULL, 0, NULL, 0};
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return 1;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return 1;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return 1;
+
+  if (parse(doc, map, st.st_size)) {
+    munmap(map, st.st_size);
+    return 1;
+  }
+  doc->map = map;
+  return 0;
+}
+
+int json_load(struct JsonDoc *doc, const char *filename) {
+  return load(doc, filename, json_parse);
+}
+
+int json_load_temp(struct JsonDoc *doc, const char *filename) {
+  return load(doc, filename, json_parse_temp);
+}
+
+void json_free(struct JsonDoc *doc) {
+  if (doc->map)
+    munmap(doc->map, doc->size);
+  if (doc->temp)
+    scratch.busy = 0;
+  else
+    mem_free(doc->tokens);
+  *doc = (struct JsonDoc){NULL, 0, NULL, 0, NULL, 0};
+}
+
+enum JsonType json_type(const struct JsonDoc *doc, int token) {
+  if (token < 0 || token >= doc->nb_tokens)
+    return JSON_NULL;
+  return doc->tokens[token].type;
+}
+
+int json_first(const struct JsonDoc *doc, int container) {
+  enum JsonType type = json_type(doc, container);
+  if ((type != JSON_ARRAY && type != JSON_OBJECT) ||
+      doc->tokens[container].next == (uint32_t)container + 1)
+    return -1;
+  return container + 1;
+}
+
+int json_next(const struct JsonDoc *doc, int container, int child) {
+  uint32_t next = doc->tokens[child].next;
+  // Skip the value of the key too
+  if (doc->tokens[container].type == JSON_OBJECT)
+    next = doc->tokens[next].next;
+  return next < doc->tokens[container].next ? (int)next : -1;
+}
+
+int json_get(const struct JsonDoc *doc, int object, const char *key) {
+  if (json_type(doc, object) != JSON_OBJECT)
+    return -1;
+  for (int k = json_first(doc, object); k >= 0; k = json_next(doc, object, k)) {
+    if (json_equals(doc, k, key))
+      return k + 1;
+  }
+  return -1;
+}
+
+int json_item(const struct JsonDoc *doc, int array, int index) {
+  if (json_type(doc, array) != JSON_ARRAY || index < 0)
+    return -1;
+  int item = json_first(doc, array);
+  while (item >= 0 && index-- > 0)
+    item = json_next(doc, array, item);
+  return item;
+}
+
+int json_size(const struct JsonDoc *doc, int container) {
+  int size = 0;
+  for (int c = json_first(doc, container); c >= 0;
+       c = json_next(doc, container, c))
+    size++;
+  return size;
+}
+
+struct JsonView json_view(const struct JsonDoc *doc, int token) {
+  if (json_type(doc, token) != JSON_STRING)
+    return (struct JsonView){"", 0};
+  const struct JsonToken *tok = &doc->tokens[token];
+  return (struct JsonView){doc->text + tok->start, tok->len};
+}
+
+long json_int(const struct JsonDoc *doc, int token) {
+  if (json_type(doc, token) != JSON_NUMBER)
+    return 0;
+  const char *read = doc->text + doc->tokens[token].start;
+  const char *end = read + doc->tokens[token].len;
+  int negative = *read == '-';
+  long value = 0;
+  if (negative)
+    read++;
+  while (read < end && *read >= '0' && *read <= '9')
+    value = value * 10 + *read++ - '0';
+  return negative ? -value : value;
+}
+
+static int hex_value(const char *str, const char *end) {
+  int value = 0;
+  if (end - str < 4)
+    return -1;
+  for (int i = 0; i < 4; i++) {
+    char c = str[i];
+    int digit = c >= '0' && c <= '9'   ? c - '0'
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                       : -1;
+    if (digit < 0)
+      return -1;
+    value = value * 16 + digit;
+  }
+  return value;
+}
+
+/**
+ * @brief Decode the next character of a string.
+ *
+ * @param read Position in the string, moved after the character
+ * @param end End of the string
+ * @param out Where the character is written, in UTF-8
+ * @return The number of bytes written
+ */
+static int decode_char(const char **read, const char *end, char out[4]) {
+  const char *str = *read;
+  if (*str != '\\' || str + 1 >= end) {
+    out[0] = *str;
+    *read = str + 1;
+    return 1;
+  }
+
+  static const char escapes[] = "b\bf\fn\nr\rt\t\"\"\\\\//";
+  // strchr() would find the terminator of `escapes` for a NUL byte
+  const char *escape = str[1] != '\0' ? strchr(escapes, str[1]) : NULL;
+  if (str[1] != 'u') {
+    out[0] = escape && (escape - escapes) % 2 == 0 ? escape[1] : str[1];
+    *read = str + 2;
+    return 1;
+  }
+
+  long code = hex_value(str + 2, end);
+  *read = str + (code < 0 ? 2 : 6);
+  if (code >= 0xD800 && code < 0xDC00) {
+    // Surrogate pair
+    const char *low = *read;
+    int second = low + 1 < end && low[0] == '\\' && low[1] == 'u'
+                     ? hex_value(low + 2, end)
+                     : -1;
+    if (second >= 0xDC00 && second < 0xE000) {
+      code = 0x10000 + ((code - 0xD800) << 10) + (second - 0xDC00);
+      *read = low + 6;
+    } else {
+      code = -1;
+    }
+  } else if (code >= 0xDC00 && code < 0xE000) {
+    code = -1;
+  }
+  if (code < 0)
+    code = 0xFFFD;
+
+  if (code < 0x80) {
+    out[0] = code;
+    return 1;
+  }
+  if (code < 0x800) {
+    out[0] = 0xC0 | (code >> 6);
+    out[1] = 0x80 | (code & 0x3F);
+    return 2;
+  }
+  if (code < 0x10000) {
+    out[0] = 0xE0 | (code >> 12);
+    out[1] = 0x80 | ((code >> 6) & 0x3F);
+    out[2] = 0x80 | (code & 0x3F);
+    return 3;
+  }
+  out[0] = 0xF0 | (code >> 18);
+  out[1] = 0x80 | ((code >> 12) & 0x3F);
+  out[2] = 0x80 | ((code >> 6) & 0x3F);
+  out[3] = 0x80 | (code & 0x3F);
+  return 4;
+}
+
+int json_equals(const struct JsonDoc *doc, int token, const char *str) {
+  struct JsonView view = json_view(doc, token);
+  if (json_type(doc, token) != JSON_STRING)
+    return 0;
+  if (!doc->tokens[token].escaped)
+    return strlen(str) == view.len && memcmp(view.ptr, str, view.len) == 0;
+
+  const char *read = view.ptr, *end = view.ptr + view.len;
+  char c[4];
+  while (read < end) {
+    int n = decode_char(&read, end, c);
+    if (strncmp(str, c, n) != 0)
+      return 0;
+    str += n;
+  }
+  return *str == '\0';
+}
+
+size_t json_decode(const struct JsonDoc *doc, int token, char *buf,
+                   size_t size) {
+  struct JsonView view = json_view(doc, token);
+  const char *read = view.ptr, *end = view.ptr + view.len;
+  size_t len = 0, written = 0;
+  char c[4];
+
+  if (view.len == 0 || !doc->tokens[token].escaped) {
+    if (size > 0) {
+      written = view.len < size ? view.len : size - 1;
+      memcpy(buf, view.ptr, written);
+      buf[written] = '\0';
+    }
+    return view.len;
+  }
+  while (read < end) {
+    int n = decode_char(&read, end, c);
+    // Never cut a character in half
+    if (written == len && len + n < size) {
+      memcpy(buf + len, c, n);
+      written += n;
+    }
+    len += n;
+  }
+  if (size > 0)
+    buf[written] = '\0';
+  return len;
+}
+
+char *json_strdup(const struct JsonDoc *doc, int token) {
+  if (json_type(doc, token) != JSON_STRING)
+    return NULL;
+  size_t len = json_decode(doc, token, NULL, 0);
+  char *str = mem_malloc(len + 1);
+  if (str == NULL)
+    return NULL;
+  json_decode(doc, token, str, len + 1);
+  return str;
+}
@@ -1,19 +1,63 @@
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 // personal files
-#include "../include/pokemon.h"
+#include "../include/card.h"
+#include "../include/color.h"
+#include "../include/dex.h"
 #include "../include/display.h"
-#include "../include/parser.h"
+#include "../include/grid.h"
+#include "../include/memstats.h"
+#include "../include/pokefetch.h"
+#include "../include/watch.h"
 
-int randrange(int min, int max) {
-  return min + rand() % (max - min + 1); 
+#define MAX_GRID 2048
+
+// Steps of --profile, CLOCK_MONOTONIC in nanoseconds, see bench_startup.py
+static int profile = 0;
+static long long started, loaded, rendered;
+
+static long long monotonic_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * @brief Record when a step of --profile is done, its output included.
+ */
+static void profile_mark(long long *mark) {
+  if (profile) {
+    fflush(stdout);
+    *mark = monotonic_ns();
+  }
+}
+
+/**
+ * @brief Write the steps of --profile, once everything is freed.
+ *
+ * The timestamps are absolute, so that the caller can measure the time
+ * spent before `main()` (execve and dynamic linking) from its own clock.
+ */
+static void report_profile(void) {
+  fflush(stdout);
+  fprintf(stderr, "profile main=%lld data=%lld render=%lld exit=%lld\n",
+          started, loaded, rendered, monotonic_ns());
+}
+
+/**
+ * @brief Write the allocations of each phase, once everything is freed.
+ */
+static void report_mem_stats(void) {
+  mem_stats_report(stderr);
 }
 
-int is_shiny(int shiny_rate) {
-  if ((rand() % shiny_rate) == 0) return 1;
+int is_shiny(struct Pokefetch *ctx, int shiny_rate) {
+  if (pokefetch_random(ctx, 1, shiny_rate) == 1) return 1;
   return 0;
 }
 
@@ -27,19 +71,86 @@ int is_number(const char *str) {
     return 1;  // Return 1 (true) if all characters are digits
 }
 
+/**
+ * @brief Check whether an option is followed by its value (e.g., --colors).
+ *
+ * @return 1 if the option takes a value, otherwise 0
+ */
+static int takes_value(const char *option) {
+  static const char *options[] = {"--colors", "--fields", "--type",
+                                  "--gen",    "--watch",  "--prefetch",
+                                  "--team",   "--data-dir", "--api"};
+  for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+    if (strcmp(option, options[i]) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Show the icons of a team, or of every pokemon matching a filter.
+ *
+ * @return 0 if the gallery was shown, otherwise 1
+ */
+int show_gallery(struct Pokefetch *ctx, struct DexFilter *filter, char *team,
+                 char *lang, enum ColorMode mode) {
+  int ids[MAX_GRID];
+  int nb_ids;
+  if (team) {
+    nb_ids = parse_team(team, ids, MAX_GRID);
+    if (nb_ids < 0) {
+      fprintf(stderr, "Invalid argument, %s must be a comma separated list of IDs.\n", team);
+      return 1;
+    }
+  } else {
+    nb_ids = pokefetch_select(ctx, filter, ids, MAX_GRID);
+  }
+  if (nb_ids == 0) {
+    fprintf(stderr, "No pokemon matches the filters.\n");
+    return 1;
+  }
+
+  int width, height;
+  terminal_size(STDOUT_FILENO, &width, &height);
+  if (width == 0)
+    width = 80;
+
+  struct GridOptions options = {"regular", lang, mode, width};
+  return pokefetch_render_grid(ctx, ids, nb_ids, &options, stdout);
+}
+
 int main(int argc, char **argv) {
-  // Init random
-  srand(time(NULL));
-  // Number of pokemon
-  int count = pokemon_count();
+  started = monotonic_ns();
+  // Directory of the local data, the default one if not given
+  char *data_dir = NULL;
+  // Base URL of the PokéAPI, the default one if not given
+  char *api = NULL;
   // Version of the pokedex
   char *version = "omega-ruby";
   // Language of the text
   char *lang = "fr";
-  // ID of the pokemon to print
-  int id = randrange(1, count);
+  // ID of the pokemon to print, random if not given
+  int id = 0;
   // Shiny rate for the pokemon
   int shiny_rate = 4;
+  // Color depth of the terminal
+  enum ColorMode mode = detect_color_mode();
+  // Fields shown on the card
+  unsigned fields = DEFAULT_FIELDS;
+  // Filter of the random pokemon, or of the pokemons of the grid
+  struct DexFilter filter = {0};
+  // Show a gallery of icons instead of a card
+  int grid = 0;
+  // Pokemons of the grid, the ones matching the filter if not given
+  char *team = NULL;
+  // Time each card stays on screen in watch mode, 0 to show a single card
+  long interval = 0;
+  // Cards rendered ahead in watch mode
+  int prefetch = 2;
+  // Update the local data instead of showing a card
+  int sync = 0;
+  // Report the allocations of each phase on exit
+  int mem_stats = 0;
 
   // Checks for parameters
   for (int i = 1; i < argc; i++) {
@@ -48,41 +159,149 @@ int main(int argc, char **argv) {
       i++;
       if (is_number(argv[i])) {
         id = atoi(argv[i]);
-      } else fprintf(stderr, "Invalid argument, %s must be an integer between 0 and %d.\n", argv[i], count); 
+      } else fprintf(stderr, "Invalid argument, %s must be a positive integer.\n", argv[i]);
     // Select a shiny rate
     } else if (strcmp(argv[i], "-s") == 0) {
       i++;
-      if (is_number(argv[i]) && (atoi(argv[i]) < 0)) {
+      if (is_number(argv[i]) && (atoi(argv[i]) > 0)) {
         shiny_rate = atoi(argv[i]);
       } else fprintf(stderr, "Invalid argument, %s must be an integer between 1 and %d.\n", argv[i], INT_MAX);
+    // Select a color depth
+    } else if (strcmp(argv[i], "--colors") == 0 && i + 1 < argc) {
+      i++;
+      if (parse_color_mode(argv[i], &mode) != 0)
+        fprintf(stderr, "Invalid argument, %s must be one of 256, 16, none or true.\n", argv[i]);
+    // Show the evolution line
+    } else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "--evolutions") == 0) {
+      fields |= FIELD_EVOLUTIONS;
+    // Select the fields of the card
+    } else if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+      i++;
+      unsigned selected;
+      if (parse_fields(argv[i], &selected) == 0) {
+        fields = selected | (fields & FIELD_EVOLUTIONS);
+      } else fprintf(stderr, "Invalid argument, %s must be a comma separated list of name, genus, types, height, weight, desc, stats, abilities, icon and evolutions.\n", argv[i]);
+    // Filter the random pokemon by type, every type must match
+    } else if (strcmp(argv[i], "--type") == 0 && i + 1 < argc) {
+      i++;
+      int type = dex_type(argv[i]);
+      if (type >= 0) {
+        filter.types |= 1u << type;
+      } else fprintf(stderr, "Invalid argument, %s must be a type in english (e.g., fire).\n", argv[i]);
+    // Filter the random pokemon by generation
+    } else if (strcmp(argv[i], "--gen") == 0 && i + 1 < argc) {
+      i++;
+      if (dex_parse_gens(argv[i], &filter.gens) != 0)
+        fprintf(stderr, "Invalid argument, %s must be generations between 1 and %d (e.g., 1-3,5).\n", argv[i], DEX_NB_GENERATIONS);
+    // Only legendary or mythical pokemons
+    } else if (strcmp(argv[i], "--legendary") == 0) {
+      filter.legendary = 1;
+    } else if (strcmp(argv[i], "--mythical") == 0) {
+      filter.mythical = 1;
+    // Show a gallery of icons
+    } else if (strcmp(argv[i], "--grid") == 0) {
+      grid = 1;
+    // Select the pokemons of the gallery
+    } else if (strcmp(argv[i], "--team") == 0 && i + 1 < argc) {
+      team = argv[++i];
+      grid = 1;
+    // Cycle through random pokemons
+    } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+      i++;
+      if (parse_interval(argv[i], &interval) != 0)
+        fprintf(stderr, "Invalid argument, %s must be a duration (e.g., 10s, 500ms, 2m).\n", argv[i]);
+    // Select the number of cards rendered ahead
+    } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+      i++;
+      if (is_number(argv[i]) && atoi(argv[i]) >= 1 && atoi(argv[i]) <= WATCH_MAX_PREFETCH) {
+        prefetch = atoi(argv[i]);
+      } else fprintf(stderr, "Invalid argument, %s must be an integer between 1 and %d.\n", argv[i], WATCH_MAX_PREFETCH);
+    // Update the local data from the PokéAPI
+    } else if (strcmp(argv[i], "--sync") == 0) {
+      sync = 1;
+    // Report when each step of the startup is done
+    } else if (strcmp(argv[i], "--profile") == 0) {
+      profile = 1;
+    // Report the allocations of each phase
+    } else if (strcmp(argv[i], "--mem-stats") == 0) {
+      mem_stats = 1;
+    // Select the local data
+    } else if (strcmp(argv[i], "--data-dir") == 0 && i + 1 < argc) {
+      data_dir = argv[++i];
+    // Select the PokéAPI
+    } else if (strcmp(argv[i], "--api") == 0 && i + 1 < argc) {
+      api = argv[++i];
+    // Last argument, without the value of its option
+    } else if (takes_value(argv[i])) {
+      fprintf(stderr, "Missing argument, %s must be followed by its value.\n", argv[i]);
     }
   }
 
-  char *json_str = fetch_pokemon(POKEAPI, "pokemon", id);
-  char *json_spe_str = fetch_pokemon(POKEAPI, "pokemon-species", id);
-  struct Pokemon pokemon = {NOT_FOUND, NOT_FOUND, 0, {NOT_FOUND, NOT_FOUND}, 
-    0, 0, NOT_FOUND, NOT_FOUND, NOT_FOUND};
-
-  char *shiny;
-  if (is_shiny(shiny_rate)) {
-    shiny = "shiny";
-  } else {
-    shiny = "regular";
+  // Before the first allocation of the library
+  if (mem_stats) {
+    mem_stats_enable();
+    atexit(report_mem_stats);
   }
+  if (profile)
+    atexit(report_profile);
 
-  if (parse_pokemon_json(&pokemon, shiny, json_str, json_spe_str, version, lang)) {
-    fprintf(stderr, "parse_pokemon_json() failed.\n");
-    free(json_str);
-    free(json_spe_str);
+  struct Pokefetch *ctx = pokefetch_new(data_dir, api);
+  if (ctx == NULL) {
+    fprintf(stderr, "Failed to create the pokefetch context.\n");
     return EXIT_FAILURE;
   }
-  free(json_str);
-  free(json_spe_str);
+  profile_mark(&loaded);
+
+  if (sync) {
+    int status = pokefetch_sync(ctx, stdout);
+    pokefetch_free(ctx);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if ((grid || interval > 0 || id == 0) && (filter.types || filter.legendary || filter.mythical) &&
+      !pokefetch_indexed(ctx))
+    fprintf(stderr, "No index of the pokemons, run make index to filter by type or rarity.\n");
 
-  if (display(&pokemon, shiny) != 0) {
-    fprintf(stderr, "Error displaying pokemon.\n");
+  if (grid) {
+    int status = show_gallery(ctx, &filter, team, lang, mode);
+    profile_mark(&rendered);
+    pokefetch_free(ctx);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // Icons are scaled down to fit in the terminal, if any
+  int columns, rows;
+  terminal_size(STDOUT_FILENO, &columns, &rows);
+
+  if (interval > 0) {
+    struct WatchOptions watch = {
+        {0, "regular", version, lang, mode, fields, columns, rows},
+        filter, shiny_rate, interval, prefetch};
+    int status = pokefetch_watch(ctx, &watch, stdout);
+    pokefetch_free(ctx);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (id == 0) {
+    id = pokefetch_random_id(ctx, &filter);
+    if (id == 0) {
+      fprintf(stderr, "No pokemon matches the filters.\n");
+      pokefetch_free(ctx);
+      return EXIT_FAILURE;
+    }
+  }
+
+  char *shiny;
+  if (is_shiny(ctx, shiny_rate)) {
+    shiny = "shiny";
+  } else {
+    shiny = "regular";
   }
 
-  free_pokemon(&pokemon);
-  return EXIT_SUCCESS;
+  struct CardOptions options = {id,   shiny,  version, lang,
+                                mode, fields, columns, rows};
+  int status = pokefetch_render(ctx, &options, stdout);
+  profile_mark(&rendered);
+  pokefetch_free(ctx);
+  return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
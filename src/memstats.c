@@ -0,0 +1,167 @@
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+// personal files
+#include "../include/memstats.h"
+
+void *(*mem_malloc)(size_t size) = malloc;
+void *(*mem_calloc)(size_t nmemb, size_t size) = calloc;
+void *(*mem_realloc)(void *ptr, size_t size) = realloc;
+void (*mem_free)(void *ptr) = free;
+
+/**
+ * @struct PhaseStats
+ * @brief Allocations of a phase, updated by every thread.
+ */
+struct PhaseStats {
+  _Atomic int64_t allocs;    /**< Allocations and reallocations */
+  _Atomic int64_t bytes;     /**< Bytes requested */
+  _Atomic int64_t peak_heap; /**< Highest heap reached during the phase */
+  _Atomic int64_t peak_rss;  /**< Highest resident set size, in KiB */
+};
+
+static const char *phase_names[NB_MEM_PHASES] = {"setup", "fetch", "parse",
+                                                 "icon", "render"};
+
+static struct PhaseStats phases[NB_MEM_PHASES];
+// Bytes allocated and not freed yet, as reported by malloc_usable_size()
+static _Atomic int64_t heap;
+static _Atomic int64_t peak_heap;
+static int enabled;
+static _Thread_local enum MemPhase current = MEM_SETUP;
+
+static void store_max(_Atomic int64_t *target, int64_t value) {
+  int64_t old = atomic_load(target);
+  while (value > old && !atomic_compare_exchange_weak(target, &old, value))
+    ;
+}
+
+/**
+ * @brief Account an allocation to the phase of the thread.
+ *
+ * @param size Bytes requested
+ * @param delta Growth of the heap
+ */
+static void account(size_t size, int64_t delta) {
+  struct PhaseStats *stats = &phases[current];
+  atomic_fetch_add(&stats->allocs, 1);
+  atomic_fetch_add(&stats->bytes, size);
+  int64_t now = atomic_fetch_add(&heap, delta) + delta;
+  store_max(&stats->peak_heap, now);
+  store_max(&peak_heap, now);
+}
+
+static void *counted_malloc(size_t size) {
+  void *ptr = malloc(size);
+  if (ptr)
+    account(size, malloc_usable_size(ptr));
+  return ptr;
+}
+
+static void *counted_calloc(size_t nmemb, size_t size) {
+  void *ptr = calloc(nmemb, size);
+  if (ptr)
+    account(nmemb * size, malloc_usable_size(ptr));
+  return ptr;
+}
+
+static void *counted_realloc(void *ptr, size_t size) {
+  int64_t before = ptr ? (int64_t)malloc_usable_size(ptr) : 0;
+  void *result = realloc(ptr, size);
+  if (result)
+    account(size, (int64_t)malloc_usable_size(result) - before);
+  return result;
+}
+
+static void counted_free(void *ptr) {
+  if (ptr)
+    atomic_fetch_sub(&heap, (int64_t)malloc_usable_size(ptr));
+  free(ptr);
+}
+
+char *mem_strdup(const char *str) {
+  size_t len = strlen(str) + 1;
+  char *copy = mem_malloc(len);
+  if (copy)
+    memcpy(copy, str, len);
+  return copy;
+}
+
+void mem_stats_enable(void) {
+  mem_malloc = counted_malloc;
+  mem_calloc = counted_calloc;
+  mem_realloc = counted_realloc;
+  mem_free = counted_free;
+  enabled = 1;
+}
+
+int mem_stats_enabled(void) {
+  return enabled;
+}
+
+/**
+ * @brief Resident set size of the process.
+ *
+ * Read without stdio, which would allocate.
+ *
+ * @return The size in KiB, 0 if unknown
+ */
+static int64_t resident_size(void) {
+  char buf[128];
+  int fd = open("/proc/self/statm", O_RDONLY);
+  if (fd < 0)
+    return 0;
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0)
+    return 0;
+  buf[len] = '\0';
+
+  // Second field, in pages
+  const char *field = strchr(buf, ' ');
+  int64_t pages = 0;
+  while (field && *++field >= '0' && *field <= '9')
+    pages = pages * 10 + *field - '0';
+  return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+enum MemPhase mem_phase(enum MemPhase phase) {
+  enum MemPhase previous = current;
+  if (enabled)
+    store_max(&phases[previous].peak_rss, resident_size());
+  current = phase;
+  return previous;
+}
+
+void mem_stats_report(FILE *out) {
+  store_max(&phases[current].peak_rss, resident_size());
+
+  int64_t allocs = 0, bytes = 0, peak_rss = 0;
+  fprintf(out, "%-8s %10s %12s %12s %14s\n", "phase", "allocs", "bytes",
+          "peak heap", "peak RSS KiB");
+  for (int i = 0; i < NB_MEM_PHASES; i++) {
+    struct PhaseStats *stats = &phases[i];
+    fprintf(out, "%-8s %10lld %12lld %12lld %14lld\n", phase_names[i],
+            (long long)stats->allocs, (long long)stats->bytes,
+            (long long)stats->peak_heap, (long long)stats->peak_rss);
+    allocs += stats->allocs;
+    bytes += stats->bytes;
+    if (stats->peak_rss > peak_rss)
+      peak_rss = stats->peak_rss;
+  }
+
+  // The samples may miss the peak between two phases
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  if (usage.ru_maxrss > peak_rss)
+    peak_rss = usage.ru_maxrss;
+  fprintf(out, "%-8s %10lld %12lld %12lld %14lld\n", "total", (long long)allocs,
+          (long long)bytes, (long long)peak_heap, (long long)peak_rss);
+  fprintf(out, "still allocated: %lld bytes\n", (long long)heap);
+}
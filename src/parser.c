@@ -1,22 +1,16 @@
-#include <cjson/cJSON.h>
+#include <ctype.h>
 #include <curl/curl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 // personal files
 #include "../include/pokemon.h"
+#include "../include/context.h"
+#include "../include/icon.h"
+#include "../include/json.h"
 #include "../include/parser.h"
-
-/**
- * @struct Memory
- * @brief A structure representing a memory space.
- *
- * This structure is used to store response from a HTTP request.
- */
-struct Memory {
-  char *response; /**< Response to save in the memory */
-  size_t size;    /**< Size of the response */
-};
+#include "../include/memstats.h"
 
 /**
  * @brief Callback function for handling HTTP response data.
@@ -36,7 +30,7 @@ size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
   size_t total_size = size * nmemb;
   struct Memory *mem = (struct Memory *)userp;
 
-  char *ptr = realloc(mem->response, mem->size + total_size + 1);
+  char *ptr = mem_realloc(mem->response, mem->size + total_size + 1);
   if (ptr == NULL)
     return 0; // Memory allocation failed
 
@@ -52,60 +46,72 @@ size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
  * @brief Function used for fetching from a HTTP response data.
  *
  * This function sends an HTTP GET request to the PokéAPI to retrieve Pokémon
- * data in JSON format based on the given Pokémon ID.
+ * data in JSON format based on the given Pokémon ID. The response comes from
+ * the cache of the context when possible, and the request shares the DNS
+ * cache, TLS sessions and cookies of the context.
  *
- * @param id ID of the pokémon to fetch (e.g., 25 for Pikachu)
+ * @param ctx Context of the request
  * @param data Where the data are fetched in the PokéAPI (e.g., 'pokemon' for
  * basic information)
+ * @param id ID of the pokémon to fetch (e.g., 25 for Pikachu), 0 for the list
  * @return A dynamically allocated string containing the API response (JSON
  * format), or `NULL` if the request fails
  *
  * @see write_callback()
  * @see Memory
  */
-char *fetch_pokemon(const char *link, const char *data, int id) {
-  curl_global_init(CURL_GLOBAL_DEFAULT);
+char *fetch_pokemon(struct Pokefetch *ctx, const char *data, int id) {
   // Curl variables
   CURL *curl;
   CURLcode res;
   struct Memory chunk = {NULL, 0};
 
+  // Build API URL
+  char url[strlen(ctx->api) + strlen(data) + 16];
+  if (id == 0) {
+    snprintf(url, sizeof(url), "%s/%s", ctx->api, data);
+  } else {
+    snprintf(url, sizeof(url), "%s/%s/%d/", ctx->api, data, id);
+  }
+
+  char *cached = cache_get(ctx, url);
+  if (cached)
+    return cached;
+
   // Initialize curl
   curl = curl_easy_init();
   if (!curl) {
     fprintf(stderr, "Curl initialization failed\n");
-    curl_global_cleanup();
     return NULL;
   }
 
-  // Build API URL
-  char url[strlen(link) + strlen(data) + 9];
-  if (id == 0) {
-    snprintf(url, sizeof(url), "%s/%s", link, data);
-  } else {
-    snprintf(url, sizeof(url), "%s/%s/%d/", link, data, id);
-  }
-
   // Setup curl_easy_setopt() options
   curl_easy_setopt(curl, CURLOPT_URL, url);
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+  curl_easy_setopt(curl, CURLOPT_SHARE, ctx->share);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)REQUEST_TIMEOUT);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)REQUEST_STALL_TIME);
 
   // Perform a HTTP request
+  enum MemPhase phase = mem_phase(MEM_FETCH);
   res = curl_easy_perform(curl);
+  mem_phase(phase);
   // Error handling
   if (res != CURLE_OK) {
     fprintf(stderr, "curl_easy_perform() failed: %s\n",
             curl_easy_strerror(res));
-    free(chunk.response);
+    mem_free(chunk.response);
     curl_easy_cleanup(curl);
-    curl_global_cleanup();
     return NULL;
   }
 
   // Clean up resources
   curl_easy_cleanup(curl);
-  curl_global_cleanup();
+  if (chunk.response)
+    cache_put(ctx, url, chunk.response);
   // Return response
   return chunk.response;
 }
@@ -119,234 +125,168 @@ char *fetch_pokemon(const char *link, const char *data, int id) {
  * If the JSON parsing fails or the "count" field is not found or is not a
  * number, the function will return `0`.
  *
+ * @param ctx Context of the request
  * @return The number of Pokémon as an integer. If an error occurs or the
  * "count" field is missing or invalid, it returns `0`
  *
  * @see fetch_pokemon()
  */
-int pokemon_count() {
-  char *json_str = fetch_pokemon(POKEAPI, "pokemon-species", 0);
-  cJSON *json = cJSON_Parse(json_str);
-  int result = 0;
-  if (!json) {
+int pokemon_count(struct Pokefetch *ctx) {
+  char *json_str = fetch_pokemon(ctx, "pokemon-species", 0);
+  struct JsonDoc doc;
+  if (json_str == NULL || json_parse_temp(&doc, json_str, strlen(json_str))) {
     fprintf(stderr, "pokemon JSON parsing failed\n");
-    free(json_str);
+    mem_free(json_str);
     return 0;
   }
-  free(json_str);
 
-  cJSON *data = cJSON_GetObjectItem(json, "count");
-  if (cJSON_IsNumber(data)) {
-    result = data->valueint;
-  }
-  cJSON_Delete(json);
+  int result = json_int(&doc, json_get(&doc, 0, "count"));
+  json_free(&doc);
+  mem_free(json_str);
   return result;
 }
 
 /**
- * @brief Retrieve a string value from a cJSON object.
- *
- * This function extracts a string from a given cJSON object by key name.
- * If the key is does not exist or is not a string, it returns "Not Found".
+ * @brief Retrieve an int value from the tape of a document.
  *
- * @param json Pointer to a cJSON object
- * @param name The key name to search for in the cJSON object
- * @return The corresponding string value if found, otherwise "Not Found"
+ * @param doc Tokenized document
+ * @param object Token of the object
+ * @param name The key name to search for in the object
+ * @return The corresponding int value if found, otherwise 0
  */
-char *get_str(cJSON *json, char *name, char *lang) {
-  cJSON *data = cJSON_GetObjectItem(json, name);
-  char *result = NOT_FOUND;
-  if (lang == NULL) {
-    if (cJSON_IsString(data)) {
-      result = strdup(data->valuestring);
-    }
-  } else {
-    int size = cJSON_GetArraySize(data);
-    for (int i = 0; i < size; i++) {
-      cJSON *name_data = cJSON_GetArrayItem(data, i);
-      cJSON *lang_data = cJSON_GetObjectItem(name_data, "language");
-      char *lang_str = cJSON_GetObjectItem(lang_data, "name")->valuestring;
-      if (strcmp(lang, lang_str) == 0) {
-        result = strdup(cJSON_GetObjectItem(name_data, "name")->valuestring);
-      }
-    }
-  }
-  return result;
+static int get_int(const struct JsonDoc *doc, int object, const char *name) {
+  return json_int(doc, json_get(doc, object, name));
 }
 
 /**
- * @brief Retrieve an int value from a cJSON object.
- *
- * This function extracts an int from a given cJSON object by key name.
- * If the key is does not exist or is not a string, it returns "Not Found".
+ * @brief Retrieve the types from a pokemon document.
  *
- * @param json Pointer to a cJSON object
- * @param name The key name to search for in the cJSON object
- * @return The corresponding int value if found, otherwise "Not Found"
- */
-int get_int(cJSON *json, char *name) {
-  cJSON *json_int = cJSON_GetObjectItem(json, name);
-  if (cJSON_IsNumber(json_int)) {
-    return json_int->valueint;
-  }
-  return 0;
-}
-
-/**
- * @brief Retrieve the types from a cJSON object.
- *
- * This function extracts either one or two string value from a given cJSON
- * object that represents the types of the pokémon. For each types not found the
+ * This function extracts either one or two string value from the document
+ * that represents the types of the pokémon. For each types not found the
  * result is "Not Found".
  *
- * @param json Pointer to a cJSON object
+ * @param doc Tokenized pokemon document
  * @param types An array of two strings to store the result
  */
-void get_types(cJSON *json, char *types[2]) {
-  cJSON *data = cJSON_GetObjectItem(json, "types");
-  if (cJSON_IsArray(data)) {
-    int size = cJSON_GetArraySize(data);
-    for (int i = 0; i < size; i++) {
-      cJSON *type_json = cJSON_GetArrayItem(data, i);
-      if (type_json) {
-        cJSON *type = cJSON_GetObjectItem(type_json, "type");
-        cJSON *name = cJSON_GetObjectItem(type, "name");
-
-        types[i] = strdup(name->valuestring);
-      }
-    }
+static void get_types(const struct JsonDoc *doc, char *types[2]) {
+  int data = json_get(doc, 0, "types");
+  int i = 0;
+  for (int entry = json_first(doc, data); entry >= 0 && i < 2;
+       entry = json_next(doc, data, entry)) {
+    char *name = json_strdup(doc, json_get(doc, json_get(doc, entry, "type"),
+                                           "name"));
+    if (name)
+      types[i] = name;
+    i++;
   }
 }
 
-char *read_json_file(const char *filename) {
-  FILE *file = fopen(filename, "r");
-  if (!file) {
-    perror("Error opening file");
-    return NULL;
+void convert_types(const char *data_dir, char *types[2], char *lang) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/types.json", data_dir);
+  struct JsonDoc doc;
+  if (json_load_temp(&doc, path)) {
+    fprintf(stderr, "Type JSON parsing failed\n");
+    return;
   }
 
-  fseek(file, 0, SEEK_END);
-  long length = ftell(file);
-  rewind(file);
-
-  char *json_data = (char *)malloc(length + 1);
-  if (!json_data) {
-    perror("Memory allocation failed");
-    fclose(file);
-    return NULL;
+  for (int entry = json_first(&doc, 0); entry >= 0;
+       entry = json_next(&doc, 0, entry)) {
+    int en = json_get(&doc, entry, "en");
+    int i = json_equals(&doc, en, types[0]) ? 0
+            : json_equals(&doc, en, types[1]) ? 1
+                                               : -1;
+    char *name = i >= 0 ? json_strdup(&doc, json_get(&doc, entry, lang)) : NULL;
+    if (name)
+      types[i] = name;
   }
-
-  fread(json_data, 1, length, file);
-  fclose(file);
-
-  json_data[length] = '\0'; // Null-terminate the string
-  return json_data;
+  json_free(&doc);
 }
 
-
-void convert_types(char *types[2], char *lang) {
-  char *json_str = read_json_file("assets/types.json");
-
-  cJSON *json = cJSON_Parse(json_str);
-  if (!json) {
-    fprintf(stderr, "Type JSON parsing failed\n");
-    return;
-  }
-
-  if (cJSON_IsArray(json)) {
-    int size = cJSON_GetArraySize(json);
-    for (int i = 0; i < size; i++) {
-      cJSON *types_json = cJSON_GetArrayItem(json, i);
-      char *type = cJSON_GetObjectItem(types_json, "en")->valuestring;
-      if (strcmp(types[0], type) == 0) {
-        types[0] = strdup(cJSON_GetObjectItem(types_json, lang)->valuestring);
-      } else if (strcmp(types[1], type) == 0) {
-        types[1] = strdup(cJSON_GetObjectItem(types_json, lang)->valuestring);
-      }
+/**
+ * @brief Retrieve a localized string from the tape of a document.
+ *
+ * PokéAPI stores the translations of a field as an array of objects with a
+ * "language" object and the translated value, possibly with a "version".
+ *
+ * @param doc Tokenized document
+ * @param array Token of the array of translations
+ * @param field Key of the translated value (e.g. "genus")
+ * @param lang Language of the value (e.g. "fr")
+ * @param version Version of the value, `NULL` if the entries have none
+ * @return The token of the value, or -1 if not found
+ */
+static int get_localized(const struct JsonDoc *doc, int array,
+                         const char *field, const char *lang,
+                         const char *version) {
+  if (json_type(doc, array) != JSON_ARRAY)
+    return -1;
+  for (int entry = json_first(doc, array); entry >= 0;
+       entry = json_next(doc, array, entry)) {
+    int lang_name = json_get(doc, json_get(doc, entry, "language"), "name");
+    if (!json_equals(doc, lang_name, lang))
+      continue;
+    if (version) {
+      int version_name =
+          json_get(doc, json_get(doc, entry, "version"), "name");
+      if (!json_equals(doc, version_name, version))
+        continue;
     }
+    int value = json_get(doc, entry, field);
+    if (json_type(doc, value) == JSON_STRING)
+      return value;
   }
-  cJSON_Delete(json);
+  return -1;
 }
 
 /**
- * @brief Retrieve the description from a cJSON object.
+ * @brief Duplicate a string of the tape of a document.
+ *
+ * @return A dynamically allocated string, or "Not Found" if the token is -1
+ */
+static char *tape_str(const struct JsonDoc *doc, int token) {
+  char *result = json_strdup(doc, token);
+  return result ? result : NOT_FOUND;
+}
+
+/**
+ * @brief Retrieve the description from a pokemon-species document.
  *
  * This function extracts the description as a string value from a given
- * cJSON object and returns it, if it does not exists returns "Not Found".
+ * document and returns it, if it does not exists returns "Not Found".
  *
- * @param json Pointer to a cJSON object
+ * @param doc Tokenized pokemon-species document
  * @param version Version of the description (e.g. "omega-ruby" by default)
  * @param lang Language of the description (e.g. "fr" by default)
  * @return The description as a string value if found, otherwise "Not Found"
  */
-char *get_desc(cJSON *json, char *version, char *lang) {
+static char *get_desc(const struct JsonDoc *doc, char *version, char *lang) {
   if (version == NULL)
     version = "omega-ruby";
   if (lang == NULL)
     lang = "fr";
 
-  cJSON *flavor_text_entries = cJSON_GetObjectItem(json, "flavor_text_entries");
-  if (cJSON_IsArray(flavor_text_entries)) {
-    int size = cJSON_GetArraySize(flavor_text_entries);
-    for (int i = 0; i < size; i++) {
-      cJSON *poke_json = cJSON_GetArrayItem(flavor_text_entries, i);
-      if (poke_json) {
-        // Get the version name
-        cJSON *version_data = cJSON_GetObjectItem(poke_json, "version");
-        cJSON *version_name = cJSON_GetObjectItem(version_data, "name");
-
-        // Get the language name
-        cJSON *lang_data = cJSON_GetObjectItem(poke_json, "language");
-        cJSON *lang_name = cJSON_GetObjectItem(lang_data, "name");
-
-        // Check if the language and the version is the one we ask for
-        if (cJSON_IsString(lang_name) && cJSON_IsString(version_name)) {
-          if (strcmp(lang_name->valuestring, lang) == 0 &&
-              strcmp(version_name->valuestring, version) == 0) {
-            cJSON *flavor_text = cJSON_GetObjectItem(poke_json, "flavor_text");
-            return strdup(flavor_text->valuestring);
-          }
-        }
-      }
-    }
-  }
-  return NOT_FOUND;
+  int entries = json_get(doc, 0, "flavor_text_entries");
+  return tape_str(doc,
+                  get_localized(doc, entries, "flavor_text", lang, version));
 }
 
 /**
- * @brief Retrieve the genus from a cJSON object.
+ * @brief Retrieve the genus from a pokemon-species document.
  *
  * This function extracts the genus as a string value from a given
- * cJSON object and returns it, if it does not exists returns "Not Found".
+ * document and returns it, if it does not exists returns "Not Found".
  *
- * @param json Pointer to a cJSON object
+ * @param doc Tokenized pokemon-species document
  * @param lang Language of the genus (e.g. "fr" by default)
  * @return The genus as a string value if found, otherwise "Not Found"
  */
-char *get_genus(cJSON *json, char *lang) {
+static char *get_genus(const struct JsonDoc *doc, char *lang) {
   if (lang == NULL)
     lang = "fr";
 
-  cJSON *data = cJSON_GetObjectItem(json, "genera");
-  if (cJSON_IsArray(data)) {
-    int size = cJSON_GetArraySize(data);
-    for (int i = 0; i < size; i++) {
-      cJSON *genus_json = cJSON_GetArrayItem(data, i);
-      if (genus_json) {
-        // Get the language name
-        cJSON *lang_data = cJSON_GetObjectItem(genus_json, "language");
-        cJSON *lang_name = cJSON_GetObjectItem(lang_data, "name");
-
-        // Check if the language and the version is the one we ask for
-        if (cJSON_IsString(lang_name)) {
-          if (strcmp(lang_name->valuestring, lang) == 0) {
-            return strdup(cJSON_GetObjectItem(genus_json, "genus")->valuestring);
-          }
-        }
-      }
-    }
-  }
-  return NOT_FOUND;
+  int genera = json_get(doc, 0, "genera");
+  return tape_str(doc, get_localized(doc, genera, "genus", lang, NULL));
 }
 
 /**
@@ -364,20 +304,19 @@ char *get_genus(cJSON *json, char *lang) {
 int fetch_icon(char *filename, char *buf, int len) {
   FILE *file = fopen(filename, "r");
   if (file == NULL) {
-    file = fopen("assets/icons/unknown.txt", "r");
-    if (file == NULL) {
-      fprintf(stderr, "Error opening file");
-      return -1;
-    }
+    return -1;
   }
 
   fseek(file, 0, SEEK_END); // end of file
   long size = ftell(file) + 1;  // get the file size
   rewind(file);             // return to the start of the file
 
-  if (len < size) return size;
+  if (len < size) {
+    fclose(file);
+    return size;
+  }
 
-  char *result = malloc(size);
+  char *result = mem_malloc(size);
   if (result == NULL) {
     perror("Error malloc");
     fclose(file);
@@ -388,95 +327,499 @@ int fetch_icon(char *filename, char *buf, int len) {
   result[size-1] = '\0';
   strcpy(buf, result);
 
-  free(result);
+  mem_free(result);
   fclose(file);
 
   return 0;
 }
 
 /**
- * @brief Parse the pokemon from two json data.
+ * @brief Load the icon of a pokémon.
+ *
+ * The icon of an unknown pokémon is used when the icon is missing.
+ *
+ * @param data_dir Directory of the local data
+ * @param alias Name of the pokémon in english
+ * @return A dynamically allocated string with the icon, or "Not Found"
+ *
+ * @see fetch_icon()
+ */
+char *load_icon(const char *data_dir, const char *alias) {
+  char imagePath[512];
+  snprintf(imagePath, sizeof(imagePath), "%s/icons/regular/%s.txt", data_dir,
+           alias);
+
+  // Image of the pokémon
+  int size = fetch_icon(imagePath, NULL, 0);
+  if (size < 0) {
+    snprintf(imagePath, sizeof(imagePath), "%s/icons/unknown.txt", data_dir);
+    size = fetch_icon(imagePath, NULL, 0);
+  }
+  if (size < 0) {
+    fprintf(stderr, "Error in parser.c: Icon not found for %s\n", alias);
+    return NOT_FOUND;
+  }
+  char *image = mem_calloc(size, sizeof(*image));
+  if (image == NULL) {
+    fprintf(stderr, "Error in parser.c: Failed to fetch pokemon icon.\n");
+    return NOT_FOUND;
+  }
+  fetch_icon(imagePath, image, size);
+  return image;
+}
+
+/**
+ * @brief Path of the largest scale of a binary icon that fits in a size.
+ *
+ * The smallest scale stored is used when none fits, and the full one when
+ * there is no limit, without reading any header.
+ *
+ * @param path Where the path is written
+ * @param size Size of the buffer
+ * @param data_dir Directory of the local data
+ * @param alias Name of the pokémon in english, "unknown" for the unknown icon
+ * @param max_width Width available, in cells, 0 for no limit
+ * @param max_height Height available, in cells, 0 for no limit
+ */
+static void icon_variant(char *path, size_t size, const char *data_dir,
+                         const char *alias, int max_width, int max_height) {
+  static const char *scales[] = {"regular", "half", "quarter"};
+  int unknown = strcmp(alias, "unknown") == 0;
+
+  // The unknown icon sits above the directories of the regular icons
+  if (unknown)
+    snprintf(path, size, "%s/icons/unknown.pki", data_dir);
+  else
+    snprintf(path, size, "%s/icons/regular/%s.pki", data_dir, alias);
+  if (max_width <= 0 && max_height <= 0)
+    return;
+
+  char candidate[512];
+  for (int i = 0; i < 3; i++) {
+    int width, height;
+    if (i == 0)
+      snprintf(candidate, sizeof(candidate), "%s", path);
+    else
+      snprintf(candidate, sizeof(candidate), "%s/icons/%s/%s.pki", data_dir,
+               scales[i], alias);
+    if (read_icon_size(candidate, &width, &height) != 0)
+      continue;
+    snprintf(path, size, "%s", candidate);
+    if ((max_width <= 0 || width <= max_width) &&
+        (max_height <= 0 || height <= max_height))
+      return;
+  }
+}
+
+char *load_colored_icon(const char *data_dir, const char *shiny,
+                        const char *alias, enum ColorMode mode, int max_width,
+                        int max_height) {
+  int is_shiny = strcmp(shiny, "shiny") == 0;
+
+  // Binary icons first, they are decoded straight in the color mode
+  char iconPath[512];
+  icon_variant(iconPath, sizeof(iconPath), data_dir, alias, max_width,
+               max_height);
+  char *packed = load_packed_icon(iconPath, mode, is_shiny);
+  if (packed)
+    return packed;
+
+  // Then the text icons of older data directories, else the unknown icon
+  snprintf(iconPath, sizeof(iconPath), "%s/icons/regular/%s.txt", data_dir,
+           alias);
+  if (access(iconPath, F_OK) != 0) {
+    icon_variant(iconPath, sizeof(iconPath), data_dir, "unknown", max_width,
+                 max_height);
+    packed = load_packed_icon(iconPath, mode, 0);
+    if (packed)
+      return packed;
+  }
+  char *icon = load_icon(data_dir, alias);
+  if (strcmp(icon, NOT_FOUND) == 0 || (mode == COLOR_TRUE && !is_shiny))
+    return icon;
+
+  // Only the regular sprite is stored, the shiny one is a palette swap
+  char palettePath[512];
+  struct Palette palette;
+  snprintf(palettePath, sizeof(palettePath), "%s/icons/regular/%s.pal",
+           data_dir, alias);
+  load_palette(palettePath, &palette);
+  char *result = color_icon(icon, mode, &palette, is_shiny);
+  free_palette(&palette);
+  mem_free(icon);
+  return result ? result : NOT_FOUND;
+}
+
+/**
+ * @brief Retrieve the base stats from a pokemon document.
+ *
+ * The stats are stored in the order of the PokéAPI: HP, attack, defense,
+ * special attack, special defense and speed.
+ *
+ * @param doc Tokenized pokemon document
+ * @param stats An array of six int to store the result
+ */
+static void get_stats(const struct JsonDoc *doc, int stats[6]) {
+  int data = json_get(doc, 0, "stats");
+  int i = 0;
+  for (int entry = json_first(doc, data); entry >= 0 && i < 6;
+       entry = json_next(doc, data, entry))
+    stats[i++] = get_int(doc, entry, "base_stat");
+}
+
+/**
+ * @brief Retrieve the abilities from a pokemon document.
  *
- * This function creates a typedef Pokemon where is stored all of its
- * information including: name, id, types, height, weight, description and
- * genus.
+ * The abilities are joined with ", ", hidden ones are followed by "*".
+ *
+ * @param doc Tokenized pokemon document
+ * @return The abilities as a string value if found, otherwise "Not Found"
+ */
+static char *get_abilities(const struct JsonDoc *doc) {
+  char result[512] = "";
+  size_t len = 0;
+  int data = json_get(doc, 0, "abilities");
+  for (int entry = json_first(doc, data); entry >= 0;
+       entry = json_next(doc, data, entry)) {
+    int name = json_get(doc, json_get(doc, entry, "ability"), "name");
+    if (json_type(doc, name) != JSON_STRING)
+      continue;
+    char ability[128];
+    json_decode(doc, name, ability, sizeof(ability));
+    len += snprintf(result + len, sizeof(result) - len, "%s%s%s",
+                    len ? ", " : "", ability,
+                    json_type(doc, json_get(doc, entry, "is_hidden")) ==
+                            JSON_TRUE
+                        ? "*" : "");
+    if (len >= sizeof(result))
+      break;
+  }
+  return len ? mem_strdup(result) : NOT_FOUND;
+}
+
+/**
+ * @brief Parse the pokemon endpoint of a pokémon.
+ *
+ * This function fills the typedef Pokemon with the information of the
+ * pokemon endpoint: alias, id, and among types, height, weight, stats and
+ * abilities only the ones asked for.
  *
  * @param json_str Json data as a string where we can find the name, id, types,
  * height and weight
- * @param json_spe_str Json data as a string where we can find the description
- * and the genus
- * @return A typedef Pokemon that contains information about it, with "Not
- * Found" or 0 as a result for each not found information
+ * @param fields Fields of the card, see `Field`
+ * @return 0 if the data was parsed, otherwise 1
  *
  * @see Pokemon
- * @see get_str()
+ * @see tape_str()
  * @see get_int()
  * @see get_types()
- * @see get_desc()
- * @see get_genus()
+ * @see get_stats()
+ * @see get_abilities()
  */
-int parse_pokemon_json(struct Pokemon *pokemon, const char *shiny, const char *json_str,
-                       const char *json_spe_str, char *version, char *lang) {
-  cJSON *json = cJSON_Parse(json_str);
-  if (!json) {
+int parse_pokemon_json(struct Pokemon *pokemon, const char *json_str,
+                       unsigned fields) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, json_str, strlen(json_str))) {
     fprintf(stderr, "pokemon JSON parsing failed\n");
     return 1;
   }
 
-  // Extract "name" field in english
-  pokemon->alias = get_str(json, "name", NULL);
+  // Extract "name" field in english, unless the local data already gave it
+  if (strcmp(pokemon->alias, NOT_FOUND) == 0)
+    pokemon->alias = tape_str(&doc, json_get(&doc, 0, "name"));
   // Extract "id" field
-  pokemon->id = get_int(json, "id");
+  pokemon->id = get_int(&doc, 0, "id");
   // Extract "types" field
-  get_types(json, pokemon->types);
-  // convert_types(pokemon->types);
+  if (fields & FIELD_TYPES)
+    get_types(&doc, pokemon->types);
   // Extract "height" field
-  pokemon->height = get_int(json, "height");
+  if (fields & FIELD_HEIGHT)
+    pokemon->height = get_int(&doc, 0, "height");
   // Extract "weight" field
-  pokemon->weight = get_int(json, "weight");
-
-  cJSON_Delete(json);
+  if (fields & FIELD_WEIGHT)
+    pokemon->weight = get_int(&doc, 0, "weight");
+  // Extract "stats" field
+  if (fields & FIELD_STATS)
+    get_stats(&doc, pokemon->stats);
+  // Extract "abilities" field
+  if (fields & FIELD_ABILITIES)
+    pokemon->abilities = get_abilities(&doc);
+
+  json_free(&doc);
+  return 0;
+}
 
-  cJSON *json_spe = cJSON_Parse(json_spe_str);
-  if (!json_spe) {
+/**
+ * @brief Parse the pokemon-species endpoint of a pokémon.
+ *
+ * This function fills the typedef Pokemon with the information of the
+ * pokemon-species endpoint asked for: name, description and genus. The name
+ * and the genus are skipped when the local data already gave them.
+ *
+ * @param json_spe_str Json data as a string where we can find the description
+ * and the genus
+ * @param version Version of the description (e.g., "omega-ruby" by default)
+ * @param lang Language of the description and genus (e.g., "fr" by default)
+ * @param fields Fields of the card, see `Field`
+ * @return 0 if the data was parsed, otherwise 1
+ *
+ * @see Pokemon
+ * @see tape_str()
+ * @see get_desc()
+ * @see get_genus()
+ */
+int parse_species_json(struct Pokemon *pokemon, const char *json_spe_str,
+                       char *version, char *lang, unsigned fields) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, json_spe_str, strlen(json_spe_str))) {
     fprintf(stderr, "pokemon-species JSON parsing failed\n");
     return 1;
   }
 
   // Extract "name" field
-  pokemon->name = get_str(json_spe, "names", lang);
+  if ((fields & FIELD_NAME) && strcmp(pokemon->name, NOT_FOUND) == 0)
+    pokemon->name = tape_str(
+        &doc, get_localized(&doc, json_get(&doc, 0, "names"), "name", lang,
+                            NULL));
   // Extract "desc" field
-  char *tmp = get_desc(json_spe, version, lang);
-  int i = 0;
-  while (tmp[i] != '\0') {
-    if (tmp[i] == '\n') tmp[i] = ' ';
-    i++;
+  if (fields & FIELD_DESC) {
+    char *tmp = get_desc(&doc, version, lang);
+    int i = 0;
+    while (tmp[i] != '\0') {
+      if (tmp[i] == '\n') tmp[i] = ' ';
+      i++;
+    }
+    pokemon->desc = tmp;
   }
-  pokemon->desc = tmp;
   // Extract "genus" field
-  pokemon->genus = get_genus(json_spe, lang);
-  // Extract "icon" field
-  char imagePath[512];
-  snprintf(imagePath, sizeof(imagePath), "%s/%s/%s.txt", "assets/icons", shiny,
-           pokemon->alias);
+  if ((fields & FIELD_GENUS) && strcmp(pokemon->genus, NOT_FOUND) == 0)
+    pokemon->genus = get_genus(&doc, lang);
 
-  // Image of the pokémon
-  int size = fetch_icon(imagePath, NULL, 0);
-  if (size < 0) {
-    fprintf(stderr, "Error in parser.c: Icon not found for %s\n", imagePath);
-  } else {
-    char *image = calloc(size, sizeof(*image));
-    fetch_icon(imagePath, image, size);
-    if (image == NULL) {
-      fprintf(stderr, "Error in parser.c: Failed to fetch pokemon icon.\n");
-      return 1;
+  json_free(&doc);
+  return 0;
+}
+
+/**
+ * @brief Name of the icon of a pokémon from its english name.
+ *
+ * This is the same transformation as the one used by `make icon`.
+ *
+ * @param name Name of the pokémon in english (e.g., "Mr. Mime")
+ * @return A dynamically allocated string (e.g., "mr-mime"), or "Not Found"
+ */
+char *icon_alias(const char *name) {
+  char *result = mem_malloc(strlen(name) * 2 + 1);
+  if (result == NULL)
+    return NOT_FOUND;
+
+  char *out = result;
+  while (*name) {
+    if (strncmp(name, "♀", strlen("♀")) == 0) {
+      out += sprintf(out, "-f");
+      name += strlen("♀");
+    } else if (strncmp(name, "♂", strlen("♂")) == 0) {
+      out += sprintf(out, "-m");
+      name += strlen("♂");
+    } else if (strncmp(name, "é", strlen("é")) == 0) {
+      *out++ = 'e';
+      name += strlen("é");
+    } else if (*name == ' ') {
+      *out++ = '-';
+      name++;
+    } else if (*name == '.' || *name == '\'' || *name == ':') {
+      name++;
+    } else {
+      *out++ = tolower((unsigned char)*name++);
     }
-    pokemon->icon = image;
   }
-  cJSON_Delete(json_spe);
+  *out = '\0';
+  return result;
+}
+
+/**
+ * @brief Fill a pokémon with the local data.
+ *
+ * `pokemons.json` holds the name and the genus of every pokémon in a
+ * few languages, which is enough for a card without any request. The alias is
+ * derived from the english name.
+ *
+ * @param id ID of the pokémon
+ * @param lang Language of the name and the genus
+ * @param fields Fields of the card, see `Field`
+ * @return 0 if every field asked for was found, otherwise 1
+ */
+int parse_local_pokemon(struct Pokefetch *ctx, struct Pokemon *pokemon, int id,
+                        char *lang, unsigned fields) {
+  const struct JsonDoc *doc = local_pokemons(ctx);
+  if (doc == NULL)
+    return 1;
+
+  // The entries are sorted by ID, check the expected index first
+  int entry = json_item(doc, 0, id - 1);
+  if (json_int(doc, json_get(doc, entry, "id")) != id) {
+    for (entry = json_first(doc, 0); entry >= 0;
+         entry = json_next(doc, 0, entry)) {
+      if (json_int(doc, json_get(doc, entry, "id")) == id)
+        break;
+    }
+  }
+  if (entry < 0)
+    return 1;
+
+  pokemon->id = id;
+  int en = json_get(doc, json_get(doc, entry, "en"), "name");
+  if (json_type(doc, en) == JSON_STRING) {
+    char name[128];
+    json_decode(doc, en, name, sizeof(name));
+    pokemon->alias = icon_alias(name);
+  }
+
+  int local = json_get(doc, entry, lang);
+  if (fields & FIELD_NAME)
+    pokemon->name = tape_str(doc, json_get(doc, local, "name"));
+  if (fields & FIELD_GENUS)
+    pokemon->genus = tape_str(doc, json_get(doc, local, "genus"));
+
+  if (strcmp(pokemon->alias, NOT_FOUND) == 0)
+    return 1;
+  if ((fields & FIELD_NAME) && strcmp(pokemon->name, NOT_FOUND) == 0)
+    return 1;
+  if ((fields & FIELD_GENUS) && strcmp(pokemon->genus, NOT_FOUND) == 0)
+    return 1;
   return 0;
 }
 
+/**
+ * @brief Retrieve the URL of the evolution chain of a pokémon.
+ *
+ * @param json_spe_str JSON data of the pokemon-species endpoint
+ * @return A dynamically allocated string with the URL, or `NULL` if not found
+ */
+char *get_evolution_chain(const char *json_spe_str) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, json_spe_str, strlen(json_spe_str))) {
+    fprintf(stderr, "pokemon-species JSON parsing failed\n");
+    return NULL;
+  }
+
+  int chain = json_get(&doc, 0, "evolution_chain");
+  char *result = json_strdup(&doc, json_get(&doc, chain, "url"));
+  json_free(&doc);
+  return result;
+}
+
+/**
+ * @brief Retrieve the ID at the end of a PokéAPI URL.
+ *
+ * @param url URL of a resource (e.g. ".../pokemon-species/25/")
+ * @return The ID, or 0 if the URL does not end with one
+ */
+static int get_url_id(const char *url) {
+  size_t len = strlen(url);
+  if (len > 0 && url[len - 1] == '/')
+    len--;
+  while (len > 0 && isdigit((unsigned char)url[len - 1]))
+    len--;
+  return atoi(url + len);
+}
+
+/**
+ * @brief Add a link of the chain and its evolutions to the members.
+ *
+ * @param doc Tokenized evolution-chain document
+ * @param link Token of the object with "species" and "evolves_to"
+ * @param stage Stage of the link in the chain
+ * @param members Array where the members are stored
+ * @param size Number of members already stored
+ * @param max Size of the array
+ * @return The new number of members
+ */
+static int add_chain_link(const struct JsonDoc *doc, int link, int stage,
+                          struct Evolution *members, int size, int max) {
+  int species = json_get(doc, link, "species");
+  int name = json_get(doc, species, "name");
+  int url = json_get(doc, species, "url");
+  if (size >= max || json_type(doc, name) != JSON_STRING ||
+      json_type(doc, url) != JSON_STRING)
+    return size;
+
+  char url_str[256];
+  json_decode(doc, url, url_str, sizeof(url_str));
+  members[size].alias = json_strdup(doc, name);
+  members[size].name = json_strdup(doc, name);
+  members[size].id = get_url_id(url_str);
+  members[size].stage = stage;
+  members[size].icon = NOT_FOUND;
+  size++;
+
+  int evolves_to = json_get(doc, link, "evolves_to");
+  for (int evolution = json_first(doc, evolves_to); evolution >= 0;
+       evolution = json_next(doc, evolves_to, evolution))
+    size = add_chain_link(doc, evolution, stage + 1, members, size, max);
+  return size;
+}
+
+/**
+ * @brief Parse the members of an evolution chain.
+ *
+ * @param json_str JSON data of the evolution-chain endpoint
+ * @param members Array where the members are stored
+ * @param max Size of the array
+ * @return The number of members, 0 if the parsing failed
+ *
+ * @see add_chain_link()
+ */
+int parse_evolution_chain(const char *json_str, struct Evolution *members,
+                          int max) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, json_str, strlen(json_str))) {
+    fprintf(stderr, "evolution-chain JSON parsing failed\n");
+    return 0;
+  }
+
+  int size = add_chain_link(&doc, json_get(&doc, 0, "chain"), 0, members, 0,
+                            max);
+  json_free(&doc);
+  return size;
+}
+
+/**
+ * @brief Retrieve the name of a pokémon from its species.
+ *
+ * @param json_spe_str JSON data of the pokemon-species endpoint
+ * @param lang Language of the name (e.g., "fr")
+ * @return A dynamically allocated string, or "Not Found"
+ */
+char *parse_species_name(const char *json_spe_str, char *lang) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, json_spe_str, strlen(json_spe_str))) {
+    fprintf(stderr, "pokemon-species JSON parsing failed\n");
+    return NOT_FOUND;
+  }
+
+  int names = json_get(&doc, 0, "names");
+  char *result = tape_str(&doc, get_localized(&doc, names, "name", lang, NULL));
+  json_free(&doc);
+  return result;
+}
+
+/**
+ * @brief Free the members of an evolution chain.
+ *
+ * @param members Array of members to free
+ * @param size Number of members
+ */
+void free_evolutions(struct Evolution *members, int size) {
+  for (int i = 0; i < size; i++) {
+    if (strcmp(members[i].name, NOT_FOUND) != 0)
+      mem_free(members[i].name);
+    if (strcmp(members[i].alias, NOT_FOUND) != 0)
+      mem_free(members[i].alias);
+    if (strcmp(members[i].icon, NOT_FOUND) != 0)
+      mem_free(members[i].icon);
+  }
+}
+
 /**
  * @brief Free the pokemon struct type
  *
@@ -489,19 +832,21 @@ int parse_pokemon_json(struct Pokemon *pokemon, const char *shiny, const char *j
  */
 void free_pokemon(struct Pokemon *pokemon) {
   if (strcmp(pokemon->name, NOT_FOUND) != 0)
-    free(pokemon->name);
+    mem_free(pokemon->name);
   if (strcmp(pokemon->alias, NOT_FOUND) != 0)
-    free(pokemon->alias);
+    mem_free(pokemon->alias);
   if (strcmp(pokemon->desc, NOT_FOUND) != 0)
-    free(pokemon->desc);
+    mem_free(pokemon->desc);
   if (strcmp(pokemon->genus, NOT_FOUND) != 0)
-    free(pokemon->genus);
+    mem_free(pokemon->genus);
   if (strcmp(pokemon->icon, NOT_FOUND) != 0)
-    free(pokemon->icon);
+    mem_free(pokemon->icon);
+  if (strcmp(pokemon->abilities, NOT_FOUND) != 0)
+    mem_free(pokemon->abilities);
   if (pokemon->types[0])
     if (strcmp(pokemon->types[0], NOT_FOUND) != 0)
-      free(pokemon->types[0]);
+      mem_free(pokemon->types[0]);
   if (pokemon->types[1])
     if (strcmp(pokemon->types[1], NOT_FOUND) != 0)
-      free(pokemon->types[1]);
+      mem_free(pokemon->types[1]);
 }
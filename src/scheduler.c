@@ -0,0 +1,416 @@
+#include <curl/curl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/context.h"
+#include "../include/parser.h"
+#include "../include/scheduler.h"
+#include "../include/memstats.h"
+
+/**
+ * @enum State
+ * @brief State of a request or a task.
+ */
+enum State {
+  STATE_WAITING, /**< Not started yet */
+  STATE_RUNNING, /**< Request in flight */
+  STATE_DONE,    /**< Finished successfully */
+  STATE_FAILED   /**< Finished with an error */
+};
+
+/**
+ * @struct Request
+ * @brief An URL fetched by the scheduler, shared by every task asking for it.
+ */
+struct Request {
+  char *url;          /**< URL of the request */
+  CURL *curl;         /**< Easy handle while the request is running */
+  struct Memory body; /**< Response of the request */
+  enum State state;   /**< State of the request */
+  int conditional;    /**< 1 if revalidated, see `scheduler_add_etag()` */
+  char *etag;         /**< ETag sent, then the one of the response */
+  struct curl_slist *headers; /**< Headers sent, while running */
+};
+
+/**
+ * @struct Task
+ * @brief A node of the graph.
+ */
+struct Task {
+  int request;             /**< Index of the request, -1 if none */
+  int *deps;               /**< Tasks this one depends on */
+  int nb_deps;             /**< Number of dependencies */
+  task_callback callback;  /**< Function called when the task is done */
+  void *userdata;          /**< Pointer given to the callback */
+  enum State state;        /**< State of the task */
+};
+
+struct Scheduler {
+  struct Pokefetch *ctx;     /**< Context sharing DNS, TLS and cache */
+  CURLM *multi;              /**< Multi handle running the requests */
+  struct Request **requests; /**< Every request, in order of creation */
+  int nb_requests;           /**< Number of requests */
+  int requests_size;         /**< Capacity of `requests` */
+  struct Task *tasks;        /**< Every task, in order of creation */
+  int nb_tasks;              /**< Number of tasks */
+  int tasks_size;            /**< Capacity of `tasks` */
+  int running;               /**< Number of requests in flight */
+  double interval;           /**< Seconds between two starts, 0 if no limit */
+  double next_start;         /**< When the next request may start */
+  int throttled;             /**< 1 if a request waits for the rate limit */
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct Scheduler *scheduler_new(struct Pokefetch *ctx, int max_connections) {
+  struct Scheduler *sched = mem_calloc(1, sizeof(*sched));
+  if (sched == NULL)
+    return NULL;
+
+  sched->ctx = ctx;
+  sched->multi = curl_multi_init();
+  if (sched->multi == NULL) {
+    fprintf(stderr, "Curl initialization failed\n");
+    mem_free(sched);
+    return NULL;
+  }
+  // Reuse the connections and multiplex the requests on them when possible
+  curl_multi_setopt(sched->multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                    (long)max_connections);
+  curl_multi_setopt(sched->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  return sched;
+}
+
+/**
+ * @brief Find the request of an URL, creating it if needed.
+ *
+ * @return The index of the request, or -1 if the allocation failed
+ */
+static int get_request(struct Scheduler *sched, const char *url,
+                       int conditional) {
+  for (int i = 0; i < sched->nb_requests; i++) {
+    if (strcmp(sched->requests[i]->url, url) == 0)
+      return i;
+  }
+
+  if (sched->nb_requests == sched->requests_size) {
+    int size = sched->requests_size ? sched->requests_size * 2 : 8;
+    struct Request **ptr = mem_realloc(sched->requests, size * sizeof(*ptr));
+    if (ptr == NULL)
+      return -1;
+    sched->requests = ptr;
+    sched->requests_size = size;
+  }
+
+  // Allocated on its own: curl writes the response through a pointer to it
+  // while callbacks may grow the array
+  struct Request *request = mem_calloc(1, sizeof(*request));
+  if (request == NULL)
+    return -1;
+  request->url = mem_strdup(url);
+  if (request->url == NULL) {
+    mem_free(request);
+    return -1;
+  }
+  request->state = STATE_WAITING;
+  request->conditional = conditional;
+  sched->requests[sched->nb_requests] = request;
+
+  // Responses already in the cache of the context are done right away
+  if (!conditional)
+    request->body.response = cache_get(sched->ctx, url);
+  if (request->body.response) {
+    request->body.size = strlen(request->body.response);
+    request->state = STATE_DONE;
+  }
+  return sched->nb_requests++;
+}
+
+/**
+ * @brief Add a task, see `scheduler_add()` and `scheduler_add_etag()`.
+ */
+static int add_task(struct Scheduler *sched, const char *url, int conditional,
+                    const int *deps, int nb_deps, task_callback callback,
+                    void *userdata) {
+  // Only tasks already added can be waited for, never a failed add (-1)
+  for (int d = 0; d < nb_deps; d++) {
+    if (deps[d] < 0 || deps[d] >= sched->nb_tasks)
+      return -1;
+  }
+
+  if (sched->nb_tasks == sched->tasks_size) {
+    int size = sched->tasks_size ? sched->tasks_size * 2 : 8;
+    struct Task *ptr = mem_realloc(sched->tasks, size * sizeof(*ptr));
+    if (ptr == NULL)
+      return -1;
+    sched->tasks = ptr;
+    sched->tasks_size = size;
+  }
+
+  struct Task task = {-1, NULL, nb_deps, callback, userdata, STATE_WAITING};
+  if (url != NULL) {
+    task.request = get_request(sched, url, conditional);
+    if (task.request < 0)
+      return -1;
+  }
+  if (nb_deps > 0) {
+    task.deps = mem_malloc(nb_deps * sizeof(*task.deps));
+    if (task.deps == NULL)
+      return -1;
+    memcpy(task.deps, deps, nb_deps * sizeof(*task.deps));
+  }
+
+  sched->tasks[sched->nb_tasks] = task;
+  return sched->nb_tasks++;
+}
+
+int scheduler_add(struct Scheduler *sched, const char *url, const int *deps,
+                  int nb_deps, task_callback callback, void *userdata) {
+  return add_task(sched, url, 0, deps, nb_deps, callback, userdata);
+}
+
+int scheduler_add_etag(struct Scheduler *sched, const char *url,
+                       const char *etag, task_callback callback,
+                       void *userdata) {
+  int task = add_task(sched, url, 1, NULL, 0, callback, userdata);
+  if (task < 0 || etag == NULL || etag[0] == '\0')
+    return task;
+
+  struct Request *request = sched->requests[sched->tasks[task].request];
+  if (request->state == STATE_WAITING && request->etag == NULL) {
+    request->etag = mem_strdup(etag);
+    if (request->etag == NULL)
+      return -1;
+  }
+  return task;
+}
+
+void scheduler_set_rate(struct Scheduler *sched, int rate) {
+  sched->interval = rate > 0 ? 1.0 / rate : 0;
+}
+
+/**
+ * @brief Add the request to the multi handle.
+ *
+ * @return 0 if the request started, otherwise 1
+ */
+static int start_request(struct Scheduler *sched, int index) {
+  struct Request *request = sched->requests[index];
+  request->curl = curl_easy_init();
+  if (request->curl == NULL) {
+    request->state = STATE_FAILED;
+    return 1;
+  }
+
+  curl_easy_setopt(request->curl, CURLOPT_URL, request->url);
+  curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, (void *)&request->body);
+  curl_easy_setopt(request->curl, CURLOPT_PRIVATE, (void *)(intptr_t)index);
+  curl_easy_setopt(request->curl, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(request->curl, CURLOPT_SHARE, sched->ctx->share);
+  curl_easy_setopt(request->curl, CURLOPT_FAILONERROR, 1L);
+  // A stalled request must not hold the run, e.g. when --watch is stopped
+  curl_easy_setopt(request->curl, CURLOPT_TIMEOUT, (long)REQUEST_TIMEOUT);
+  curl_easy_setopt(request->curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(request->curl, CURLOPT_LOW_SPEED_TIME,
+                   (long)REQUEST_STALL_TIME);
+  if (request->etag) {
+    char header[256];
+    snprintf(header, sizeof(header), "If-None-Match: %s", request->etag);
+    request->headers = curl_slist_append(NULL, header);
+    curl_easy_setopt(request->curl, CURLOPT_HTTPHEADER, request->headers);
+  }
+  curl_multi_add_handle(sched->multi, request->curl);
+  request->state = STATE_RUNNING;
+  sched->running++;
+  return 0;
+}
+
+/**
+ * @brief Collect the requests finished by the multi handle.
+ */
+static void finish_requests(struct Scheduler *sched) {
+  CURLMsg *msg;
+  int left;
+  while ((msg = curl_multi_info_read(sched->multi, &left))) {
+    if (msg->msg != CURLMSG_DONE)
+      continue;
+
+    char *private;
+    long code = 0;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private);
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &code);
+    long index = (long)(intptr_t)private;
+    struct Request *request = sched->requests[index];
+    if (msg->data.result == CURLE_OK && request->conditional &&
+        (request->body.response || code == 304)) {
+      // Keep the ETag of the response, the one sent if not modified
+      struct curl_header *etag;
+      if (code != 304 &&
+          curl_easy_header(request->curl, "ETag", 0, CURLH_HEADER, -1,
+                           &etag) == CURLHE_OK) {
+        mem_free(request->etag);
+        request->etag = mem_strdup(etag->value);
+      }
+      request->state = STATE_DONE;
+    } else if (msg->data.result == CURLE_OK && request->body.response) {
+      request->state = STATE_DONE;
+      cache_put(sched->ctx, request->url, request->body.response);
+    } else {
+      fprintf(stderr, "curl_easy_perform() failed for %s: %s\n", request->url,
+              curl_easy_strerror(msg->data.result));
+      request->state = STATE_FAILED;
+    }
+    curl_multi_remove_handle(sched->multi, request->curl);
+    curl_easy_cleanup(request->curl);
+    curl_slist_free_all(request->headers);
+    request->curl = NULL;
+    request->headers = NULL;
+    sched->running--;
+  }
+}
+
+/**
+ * @brief Advance every task that can be advanced.
+ *
+ * Starts the requests whose dependencies are done and runs the callbacks of
+ * the tasks that are resolved. Callbacks may add tasks, so the loop goes on
+ * until nothing changes.
+ */
+static void advance_tasks(struct Scheduler *sched) {
+  int progress = 1;
+  while (progress) {
+    progress = 0;
+    for (int i = 0; i < sched->nb_tasks; i++) {
+      struct Task *task = &sched->tasks[i];
+      if (task->state == STATE_DONE || task->state == STATE_FAILED)
+        continue;
+
+      // Wait for every dependency, even after one of them failed, so the
+      // callback sees all the results there are
+      enum State state = STATE_DONE;
+      for (int d = 0; d < task->nb_deps; d++) {
+        enum State dep = sched->tasks[task->deps[d]].state;
+        if (dep != STATE_DONE && dep != STATE_FAILED) {
+          state = STATE_WAITING;
+          break;
+        }
+        if (dep == STATE_FAILED)
+          state = STATE_FAILED;
+      }
+
+      // Then for the request, evenly spaced when the rate is limited
+      if (state == STATE_DONE && task->request >= 0) {
+        struct Request *request = sched->requests[task->request];
+        if (request->state == STATE_WAITING) {
+          double time = sched->interval > 0 ? now() : 0;
+          if (time >= sched->next_start) {
+            start_request(sched, task->request);
+            if (sched->interval > 0)
+              sched->next_start =
+                  (sched->next_start > time - sched->interval
+                       ? sched->next_start
+                       : time) +
+                  sched->interval;
+          } else {
+            sched->throttled = 1;
+          }
+        }
+        state = request->state;
+      }
+      if (state != STATE_DONE && state != STATE_FAILED)
+        continue;
+
+      task->state = state;
+      progress = 1;
+      if (task->callback) {
+        // The callback may grow the tasks array, do not keep `task` around
+        task->callback(sched, i, task->userdata);
+      }
+    }
+  }
+}
+
+int scheduler_run(struct Scheduler *sched) {
+  int still_running;
+  sched->throttled = 0;
+  advance_tasks(sched);
+  while (sched->running > 0 || sched->throttled) {
+    enum MemPhase phase = mem_phase(MEM_FETCH);
+    curl_multi_perform(sched->multi, &still_running);
+    finish_requests(sched);
+    mem_phase(phase);
+    // May start new requests, which are picked up by the next perform
+    sched->throttled = 0;
+    advance_tasks(sched);
+
+    // Wake up for the next start allowed by the rate limit
+    int timeout = 1000;
+    if (sched->throttled) {
+      double wait = sched->next_start - now();
+      timeout = wait > 0 ? (int)(wait * 1000) + 1 : 0;
+      if (timeout > 1000)
+        timeout = 1000;
+    }
+    if (sched->running > 0 || sched->throttled)
+      curl_multi_poll(sched->multi, NULL, 0, timeout, NULL);
+  }
+
+  int failed = 0;
+  for (int i = 0; i < sched->nb_tasks; i++) {
+    if (sched->tasks[i].state != STATE_DONE)
+      failed++;
+  }
+  return failed;
+}
+
+const char *scheduler_body(struct Scheduler *sched, int task) {
+  if (task < 0 || task >= sched->nb_tasks || sched->tasks[task].request < 0)
+    return NULL;
+  struct Request *request = sched->requests[sched->tasks[task].request];
+  return request->state == STATE_DONE ? request->body.response : NULL;
+}
+
+const char *scheduler_etag(struct Scheduler *sched, int task) {
+  if (task < 0 || task >= sched->nb_tasks || sched->tasks[task].request < 0)
+    return NULL;
+  struct Request *request = sched->requests[sched->tasks[task].request];
+  return request->state == STATE_DONE ? request->etag : NULL;
+}
+
+int scheduler_failed(struct Scheduler *sched, int task) {
+  if (task < 0 || task >= sched->nb_tasks)
+    return 1;
+  return sched->tasks[task].state == STATE_FAILED;
+}
+
+void scheduler_free(struct Scheduler *sched) {
+  if (sched == NULL)
+    return;
+  for (int i = 0; i < sched->nb_requests; i++) {
+    struct Request *request = sched->requests[i];
+    if (request->curl) {
+      curl_multi_remove_handle(sched->multi, request->curl);
+      curl_easy_cleanup(request->curl);
+    }
+    curl_slist_free_all(request->headers);
+    mem_free(request->url);
+    mem_free(request->etag);
+    mem_free(request->body.response);
+    mem_free(request);
+  }
+  for (int i = 0; i < sched->nb_tasks; i++)
+    mem_free(sched->tasks[i].deps);
+  mem_free(sched->requests);
+  mem_free(sched->tasks);
+  curl_multi_cleanup(sched->multi);
+  mem_free(sched);
+}
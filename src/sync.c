@@ -0,0 +1,606 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+// personal files
+#include "../include/pokemon.h"
+#include "../include/context.h"
+#include "../include/dex.h"
+#include "../include/json.h"
+#include "../include/parser.h"
+#include "../include/scheduler.h"
+#include "../include/sync.h"
+#include "../include/memstats.h"
+
+#define ETAG_SIZE 128
+#define NB_LANGUAGES 2
+
+/**
+ * @enum Resource
+ * @brief Endpoints of the PokéAPI the local data is built from.
+ */
+enum Resource {
+  RESOURCE_SPECIES, /**< Names, genera, generation and rarity */
+  RESOURCE_POKEMON, /**< Types and stats, only kept for `index.bin` */
+  NB_RESOURCES
+};
+
+static const char *resource_names[NB_RESOURCES] = {"pokemon-species",
+                                                   "pokemon"};
+
+// Languages of `pokemons.json`, in the order of its entries
+static char *languages[NB_LANGUAGES] = {"fr", "en"};
+
+/**
+ * @struct SyncEntry
+ * @brief State of a species during a sync.
+ */
+struct SyncEntry {
+  long checked[NB_RESOURCES];          /**< Last check, 0 if never */
+  char etag[NB_RESOURCES][ETAG_SIZE];  /**< ETag of the last check */
+  unsigned missing;                    /**< Resources not in the local data */
+  int rebuilt;                         /**< 1 if the entry was fetched again */
+  char *names[NB_LANGUAGES];           /**< Names, once rebuilt */
+  char *genera[NB_LANGUAGES];          /**< Genera, once rebuilt */
+  struct DexRow row;                   /**< Row of `index.bin` */
+};
+
+struct Sync;
+
+/**
+ * @struct SyncTask
+ * @brief Resource fetched by a task of the scheduler.
+ */
+struct SyncTask {
+  struct Sync *sync;
+  int id;
+  enum Resource resource;
+};
+
+/**
+ * @struct Sync
+ * @brief State of a sync.
+ */
+struct Sync {
+  struct Pokefetch *ctx;
+  struct SyncEntry *entries;  /**< Entry of ID `id` at `id - 1` */
+  int *local_entries;         /**< Token of each entry of `pokemons.json` */
+  struct SyncTask *tasks;     /**< One per request */
+  int nb_tasks;
+  int local;                  /**< Species in `pokemons.json` */
+  int rows;                   /**< Rows in `index.bin`, 0 without index */
+  int known;                  /**< Species upstream at the last sync */
+  int upstream;               /**< Species in the PokéAPI */
+  int count;                  /**< Size of `entries` */
+  int has_index;              /**< 1 if `index.bin` is kept up to date */
+  int dirty;                  /**< 1 if the local data must be rewritten */
+  int responses;              /**< Responses since the start */
+  int nb_new, nb_changed, nb_unmodified, nb_failed;
+};
+
+/**
+ * @brief Read the number of species, the ETags and the checks of the
+ * previous syncs.
+ *
+ * A missing manifest is the one of a data directory never synced, whose
+ * species are the ones of the local data.
+ */
+static void read_manifest(struct Sync *sync) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", sync->ctx->data_dir, SYNC_MANIFEST);
+  sync->known = sync->local;
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return;
+
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    char resource[32], etag[ETAG_SIZE];
+    int id;
+    long checked;
+    if (sscanf(line, "count %d", &id) == 1) {
+      sync->known = id;
+      continue;
+    }
+    if (sscanf(line, "%31s %d %ld %127s", resource, &id, &checked, etag) != 4)
+      continue;
+    if (id < 1 || id > sync->count)
+      continue;
+    for (int r = 0; r < NB_RESOURCES; r++) {
+      if (strcmp(resource, resource_names[r]) != 0)
+        continue;
+      struct SyncEntry *entry = &sync->entries[id - 1];
+      entry->checked[r] = checked;
+      snprintf(entry->etag[r], ETAG_SIZE, "%s",
+               strcmp(etag, "-") == 0 ? "" : etag);
+    }
+  }
+  fclose(file);
+}
+
+/**
+ * @brief Write a string as a JSON string.
+ */
+static void write_string(FILE *file, const char *str) {
+  fputc('"', file);
+  for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      fprintf(file, "\\%c", *c);
+    else if (*c == '\n')
+      fputs("\\n", file);
+    else if (*c < 0x20)
+      fprintf(file, "\\u%04x", *c);
+    else
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+/**
+ * @brief Write a rebuilt entry of `pokemons.json`, in the layout of the file.
+ */
+static void write_entry(FILE *file, int id, const struct SyncEntry *entry) {
+  fprintf(file, "  {\n    \"id\": %d", id);
+  for (int l = 0; l < NB_LANGUAGES; l++) {
+    if (entry->names[l] == NULL && entry->genera[l] == NULL)
+      continue;
+    fprintf(file, ",\n    \"%s\": { ", languages[l]);
+    if (entry->names[l]) {
+      fputs("\"name\": ", file);
+      write_string(file, entry->names[l]);
+    }
+    if (entry->genera[l]) {
+      fputs(entry->names[l] ? ", \"genus\": " : "\"genus\": ", file);
+      write_string(file, entry->genera[l]);
+    }
+    fputs(" }", file);
+  }
+  fputs("\n  }", file);
+}
+
+/**
+ * @brief Move a file written aside over the one it replaces.
+ *
+ * @return 0 if the file was replaced, otherwise 1
+ */
+static int replace(const char *tmp, const char *path, FILE *file) {
+  int failed = ferror(file);
+  if (fclose(file) != 0 || failed || rename(tmp, path) != 0) {
+    fprintf(stderr, "Error in sync.c: could not write %s\n", path);
+    remove(tmp);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Rewrite `pokemons.json`, entries not rebuilt are copied as they are.
+ *
+ * @param nb Number of entries, the complete ones from the first ID
+ */
+static int save_pokemons(struct Sync *sync, int nb) {
+  const struct JsonDoc *local = &sync->ctx->local;
+  char path[512], tmp[520];
+  snprintf(path, sizeof(path), "%s/pokemons.json", sync->ctx->data_dir);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Error in sync.c: could not write %s\n", path);
+    return 1;
+  }
+
+  fputs("[\n", file);
+  for (int id = 1; id <= nb; id++) {
+    const struct SyncEntry *entry = &sync->entries[id - 1];
+    if (entry->rebuilt) {
+      write_entry(file, id, entry);
+    } else {
+      const struct JsonToken *token =
+          &local->tokens[sync->local_entries[id - 1]];
+      fputs("  ", file);
+      fwrite(local->text + token->start, 1, token->len, file);
+    }
+    fputs(id < nb ? ",\n" : "\n", file);
+  }
+  fputs("]\n", file);
+  return replace(tmp, path, file);
+}
+
+/**
+ * @brief Rewrite `index.bin` with the rows of the complete species.
+ */
+static int save_index(struct Sync *sync, int nb) {
+  struct DexRow *rows = mem_malloc((nb > 0 ? nb : 1) * sizeof(*rows));
+  if (rows == NULL)
+    return 1;
+  for (int i = 0; i < nb; i++)
+    rows[i] = sync->entries[i].row;
+
+  char path[512], tmp[520];
+  snprintf(path, sizeof(path), "%s/index.bin", sync->ctx->data_dir);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  int status = dex_write(tmp, rows, nb);
+  mem_free(rows);
+  if (status == 0 && rename(tmp, path) != 0) {
+    fprintf(stderr, "Error in sync.c: could not write %s\n", path);
+    remove(tmp);
+    status = 1;
+  }
+  return status;
+}
+
+/**
+ * @brief Write the ETags and the checks of every resource.
+ */
+static int save_manifest(struct Sync *sync) {
+  char path[512], tmp[520];
+  snprintf(path, sizeof(path), "%s/%s", sync->ctx->data_dir, SYNC_MANIFEST);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Error in sync.c: could not write %s\n", path);
+    return 1;
+  }
+
+  fprintf(file, "count %d\n", sync->upstream);
+  for (int id = 1; id <= sync->count; id++) {
+    const struct SyncEntry *entry = &sync->entries[id - 1];
+    for (int r = 0; r < NB_RESOURCES; r++) {
+      if (entry->checked[r] == 0)
+        continue;
+      fprintf(file, "%s %d %ld %s\n", resource_names[r], id, entry->checked[r],
+              entry->etag[r][0] ? entry->etag[r] : "-");
+    }
+  }
+  return replace(tmp, path, file);
+}
+
+/**
+ * @brief Write the local data fetched so far, then the manifest.
+ *
+ * Only the species complete from the first ID are written, the next sync
+ * fetches the others again. The manifest is written last, so it never
+ * describes data that is not on disk.
+ *
+ * @return 0 if everything was written, otherwise 1
+ */
+static int save(struct Sync *sync) {
+  int status = 0;
+  if (sync->dirty) {
+    int nb_species = 0, nb_rows = 0;
+    while (nb_species < sync->count &&
+           !(sync->entries[nb_species].missing & (1 << RESOURCE_SPECIES)))
+      nb_species++;
+    while (nb_rows < nb_species && sync->entries[nb_rows].missing == 0)
+      nb_rows++;
+
+    status |= save_pokemons(sync, nb_species);
+    if (sync->has_index)
+      status |= save_index(sync, nb_rows);
+    if (status != 0)
+      return status;
+    sync->dirty = 0;
+  }
+  return save_manifest(sync);
+}
+
+/**
+ * @brief Rebuild the entry and the generation of a species.
+ *
+ * @return 0 if the species was parsed, otherwise 1
+ */
+static int parse_species(struct SyncEntry *entry, const char *body) {
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, body, strlen(body))) {
+    fprintf(stderr, "pokemon-species JSON parsing failed\n");
+    return 1;
+  }
+  char generation[32];
+  json_decode(&doc, json_get(&doc, json_get(&doc, 0, "generation"), "name"),
+              generation, sizeof(generation));
+  entry->row.gen = dex_generation(generation);
+  entry->row.flags =
+      (json_type(&doc, json_get(&doc, 0, "is_legendary")) == JSON_TRUE
+           ? DEX_LEGENDARY
+           : 0) |
+      (json_type(&doc, json_get(&doc, 0, "is_mythical")) == JSON_TRUE
+           ? DEX_MYTHICAL
+           : 0);
+  json_free(&doc);
+
+  for (int l = 0; l < NB_LANGUAGES; l++) {
+    struct Pokemon pokemon = {NOT_FOUND, NOT_FOUND, 0, {NOT_FOUND, NOT_FOUND},
+                              0, 0, NOT_FOUND, NOT_FOUND, NOT_FOUND, {0},
+                              NOT_FOUND};
+    parse_species_json(&pokemon, body, NULL, languages[l],
+                       FIELD_NAME | FIELD_GENUS);
+    mem_free(entry->names[l]);
+    mem_free(entry->genera[l]);
+    entry->names[l] = NULL;
+    entry->genera[l] = NULL;
+    // Ownership of the strings moves to the entry
+    if (strcmp(pokemon.name, NOT_FOUND) != 0) {
+      entry->names[l] = pokemon.name;
+      pokemon.name = NOT_FOUND;
+    }
+    if (strcmp(pokemon.genus, NOT_FOUND) != 0) {
+      entry->genera[l] = pokemon.genus;
+      pokemon.genus = NOT_FOUND;
+    }
+    free_pokemon(&pokemon);
+  }
+  entry->rebuilt = 1;
+  return 0;
+}
+
+/**
+ * @brief Rebuild the types and the stats of a species.
+ *
+ * @return 0 if the pokémon was parsed, otherwise 1
+ */
+static int parse_pokemon(struct SyncEntry *entry, const char *body) {
+  struct Pokemon pokemon = {NOT_FOUND, NOT_FOUND, 0, {NOT_FOUND, NOT_FOUND},
+                            0, 0, NOT_FOUND, NOT_FOUND, NOT_FOUND, {0},
+                            NOT_FOUND};
+  if (parse_pokemon_json(&pokemon, body, FIELD_TYPES | FIELD_STATS)) {
+    free_pokemon(&pokemon);
+    return 1;
+  }
+  for (int i = 0; i < 2; i++) {
+    int type = pokemon.types[i] && strcmp(pokemon.types[i], NOT_FOUND) != 0
+                   ? dex_type(pokemon.types[i])
+                   : -1;
+    entry->row.types[i] = type < 0 ? 0xFF : type;
+  }
+  for (int i = 0; i < 6; i++) {
+    int stat = pokemon.stats[i];
+    entry->row.stats[i] = stat < 0 ? 0 : stat > 255 ? 255 : stat;
+  }
+  free_pokemon(&pokemon);
+  return 0;
+}
+
+/**
+ * @brief Rebuild a species from a resource.
+ *
+ * @return 0 if the resource was parsed, otherwise 1
+ */
+static int parse_resource(struct SyncEntry *entry, enum Resource resource,
+                          const char *body) {
+  enum MemPhase phase = mem_phase(MEM_PARSE);
+  int status = resource == RESOURCE_SPECIES ? parse_species(entry, body)
+                                            : parse_pokemon(entry, body);
+  mem_phase(phase);
+  return status;
+}
+
+/**
+ * @brief Callback of the request of a resource.
+ */
+static void on_resource(struct Scheduler *sched, int task, void *userdata) {
+  struct SyncTask *sync_task = userdata;
+  struct Sync *sync = sync_task->sync;
+  struct SyncEntry *entry = &sync->entries[sync_task->id - 1];
+  enum Resource resource = sync_task->resource;
+  const char *body = scheduler_body(sched, task);
+
+  if (scheduler_failed(sched, task)) {
+    sync->nb_failed++;
+  } else if (body == NULL) {
+    sync->nb_unmodified++;
+  } else if (parse_resource(entry, resource, body) != 0) {
+    sync->nb_failed++;
+    return;
+  } else {
+    if (entry->missing & (1 << resource))
+      sync->nb_new++;
+    else
+      sync->nb_changed++;
+    entry->missing &= ~(1u << resource);
+    sync->dirty = 1;
+  }
+
+  if (!scheduler_failed(sched, task)) {
+    const char *etag = scheduler_etag(sched, task);
+    entry->checked[resource] = time(NULL);
+    snprintf(entry->etag[resource], ETAG_SIZE, "%s", etag ? etag : "");
+  }
+  // Checkpoint, an interrupted sync resumes from here
+  if (++sync->responses % SYNC_CHECKPOINT == 0)
+    save(sync);
+}
+
+/**
+ * @brief Add the request of a resource.
+ *
+ * @param etag ETag of the local copy, `NULL` to fetch the resource
+ */
+static void fetch(struct Scheduler *sched, struct Sync *sync, int id,
+                  enum Resource resource, const char *etag) {
+  char url[strlen(sync->ctx->api) + 64];
+  snprintf(url, sizeof(url), "%s/%s/%d/", sync->ctx->api,
+           resource_names[resource], id);
+  struct SyncTask *task = &sync->tasks[sync->nb_tasks++];
+  *task = (struct SyncTask){sync, id, resource};
+  scheduler_add_etag(sched, url, etag && etag[0] ? etag : NULL, on_resource,
+                     task);
+}
+
+/**
+ * @struct Check
+ * @brief A resource of the local data that can be revalidated.
+ */
+struct Check {
+  long checked;
+  int id;
+  enum Resource resource;
+};
+
+static int compare_checks(const void *a, const void *b) {
+  const struct Check *x = a, *y = b;
+  if (x->checked != y->checked)
+    return x->checked < y->checked ? -1 : 1;
+  if (x->id != y->id)
+    return x->id - y->id;
+  return (int)x->resource - (int)y->resource;
+}
+
+/**
+ * @brief Callback of the number of species, adds the other requests.
+ *
+ * The species added upstream since the last sync and the ones missing from
+ * the local data are fetched, and the SYNC_REVALIDATE resources of the local
+ * data checked the longest time ago are revalidated with their ETag.
+ */
+static void on_count(struct Scheduler *sched, int task, void *userdata) {
+  struct Sync *sync = userdata;
+  const char *body = scheduler_body(sched, task);
+  if (body == NULL)
+    return;
+
+  struct JsonDoc doc;
+  if (json_parse_temp(&doc, body, strlen(body))) {
+    fprintf(stderr, "pokemon-species JSON parsing failed\n");
+    sync->nb_failed++;
+    return;
+  }
+  sync->upstream = json_int(&doc, json_get(&doc, 0, "count"));
+  json_free(&doc);
+
+  sync->count = sync->upstream > sync->local ? sync->upstream : sync->local;
+  sync->entries = mem_calloc(sync->count > 0 ? sync->count : 1,
+                         sizeof(*sync->entries));
+  sync->tasks = mem_calloc(sync->count * NB_RESOURCES + 1, sizeof(*sync->tasks));
+  struct Check *checks =
+      mem_malloc((sync->count * NB_RESOURCES + 1) * sizeof(*checks));
+  if (sync->entries == NULL || sync->tasks == NULL || checks == NULL) {
+    mem_free(checks);
+    sync->nb_failed++;
+    return;
+  }
+
+  read_manifest(sync);
+  int nb_checks = 0;
+  for (int id = 1; id <= sync->count; id++) {
+    struct SyncEntry *entry = &sync->entries[id - 1];
+    entry->row = (struct DexRow){{0xFF, 0xFF}, 0, 0, {0}};
+    if (id <= sync->rows)
+      dex_row(&sync->ctx->dex, id, &entry->row);
+    if (id > sync->local)
+      entry->missing |= 1 << RESOURCE_SPECIES;
+    if (sync->has_index && id > sync->rows)
+      entry->missing |= 1 << RESOURCE_POKEMON;
+  }
+
+  for (int id = 1; id <= sync->count; id++) {
+    struct SyncEntry *entry = &sync->entries[id - 1];
+    for (int r = 0; r < NB_RESOURCES; r++) {
+      if (r == RESOURCE_POKEMON && !sync->has_index)
+        continue;
+      // Species new upstream are fetched even if the local data has them
+      if ((entry->missing & (1 << r)) || id > sync->known)
+        fetch(sched, sync, id, r, NULL);
+      else
+        checks[nb_checks++] = (struct Check){entry->checked[r], id, r};
+    }
+  }
+
+  qsort(checks, nb_checks, sizeof(*checks), compare_checks);
+  for (int i = 0; i < nb_checks && i < SYNC_REVALIDATE; i++) {
+    const struct SyncEntry *entry = &sync->entries[checks[i].id - 1];
+    fetch(sched, sync, checks[i].id, checks[i].resource,
+          entry->etag[checks[i].resource]);
+  }
+  mem_free(checks);
+}
+
+/**
+ * @brief Number of rebuilt species without an icon.
+ *
+ * Icons come from another source than the PokéAPI, `get_icons.py` only
+ * fetches the ones missing.
+ */
+static int missing_icons(const struct Sync *sync) {
+  int nb = 0;
+  for (int i = 0; i < sync->count; i++) {
+    const char *name = sync->entries[i].names[1];
+    if (!sync->entries[i].rebuilt || name == NULL)
+      continue;
+    char *alias = icon_alias(name);
+    if (strcmp(alias, NOT_FOUND) == 0)
+      continue;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/icons/regular/%s.pki",
+             sync->ctx->data_dir, alias);
+    nb += access(path, F_OK) != 0;
+    mem_free(alias);
+  }
+  return nb;
+}
+
+int sync_data(struct Pokefetch *ctx, FILE *out) {
+  struct Sync sync = {0};
+  sync.ctx = ctx;
+  sync.local = json_size(&ctx->local, 0);
+  sync.has_index = ctx->dex.has_types || sync.local == 0;
+  sync.rows = ctx->dex.has_types ? ctx->dex.count : 0;
+
+  // Entries of the local data, copied as they are unless rebuilt
+  sync.local_entries = mem_malloc((sync.local > 0 ? sync.local : 1) *
+                              sizeof(*sync.local_entries));
+  if (sync.local_entries == NULL)
+    return 1;
+  int nb = 0;
+  if (sync.local > 0) {
+    for (int t = json_first(&ctx->local, 0); t >= 0;
+         t = json_next(&ctx->local, 0, t)) {
+      if (json_int(&ctx->local, json_get(&ctx->local, t, "id")) != nb + 1)
+        break;
+      sync.local_entries[nb++] = t;
+    }
+  }
+  // Entries out of order are fetched again
+  sync.local = nb;
+
+  struct Scheduler *sched = scheduler_new(ctx, SYNC_CONNECTIONS);
+  if (sched == NULL) {
+    mem_free(sync.local_entries);
+    return 1;
+  }
+  scheduler_set_rate(sched, SYNC_RATE);
+  char url[strlen(ctx->api) + 32];
+  snprintf(url, sizeof(url), "%s/pokemon-species/?limit=1", ctx->api);
+  scheduler_add_etag(sched, url, NULL, on_count, &sync);
+  int failed = scheduler_run(sched);
+  scheduler_free(sched);
+
+  int status = failed > 0 || sync.nb_failed > 0;
+  if (sync.entries) {
+    status |= save(&sync);
+    fprintf(out, "Species: %d local, %d at the last sync, %d upstream\n",
+            sync.local, sync.known, sync.upstream);
+    fprintf(out,
+            "Requests: %d (%d new, %d changed, %d not modified, %d failed)\n",
+            sync.nb_tasks + 1, sync.nb_new, sync.nb_changed,
+            sync.nb_unmodified, sync.nb_failed);
+    int nb_icons = missing_icons(&sync);
+    if (nb_icons > 0)
+      fprintf(out, "Icons: %d missing, run `python3 get_icons.py` to fetch "
+                   "them\n", nb_icons);
+    for (int i = 0; i < sync.count; i++) {
+      for (int l = 0; l < NB_LANGUAGES; l++) {
+        mem_free(sync.entries[i].names[l]);
+        mem_free(sync.entries[i].genera[l]);
+      }
+    }
+  } else {
+    fprintf(stderr, "Error in sync.c: could not get the number of species\n");
+    status = 1;
+  }
+
+  mem_free(sync.entries);
+  mem_free(sync.tasks);
+  mem_free(sync.local_entries);
+  return status;
+}
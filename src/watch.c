@@ -0,0 +1,397 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+// personal files
+#include "../include/display.h"
+#include "../include/pokefetch.h"
+#include "../include/watch.h"
+#include "../include/memstats.h"
+
+// Alternate screen without cursor, and back
+#define SCREEN_ENTER "\033[?1049h\033[?25l\033[2J"
+#define SCREEN_LEAVE "\033[?25h\033[?1049l"
+
+/**
+ * @struct WatchQueue
+ * @brief Cards rendered ahead by the background thread.
+ */
+struct WatchQueue {
+  struct Pokefetch *ctx;            /**< Context of the cards */
+  struct WatchOptions *options;     /**< How to cycle */
+  char *cards[WATCH_MAX_PREFETCH];  /**< Rendered cards, oldest first */
+  int head;                         /**< Index of the oldest card */
+  int count;                        /**< Number of cards ready */
+  int stop;                         /**< 1 once the slideshow ends */
+  pthread_mutex_t lock;             /**< Lock of the queue */
+  pthread_cond_t changed;           /**< Signaled on push, pop and stop */
+};
+
+/**
+ * @struct Frame
+ * @brief A card on screen, split in lines.
+ *
+ * The array of lines only grows, so a frame allocates nothing once it has
+ * seen the tallest card.
+ */
+struct Frame {
+  char *text;   /**< The card, its newlines replaced by NUL */
+  char **lines; /**< Start of each line in `text` */
+  int nb_lines; /**< Number of lines */
+  int size;     /**< Capacity of `lines` */
+};
+
+/**
+ * @struct Output
+ * @brief Buffer of the escape sequences of a redraw, it only grows.
+ */
+struct Output {
+  char *data;      /**< Content of the buffer */
+  size_t len;      /**< Length of the content */
+  size_t capacity; /**< Size of `data` */
+};
+
+// Set by the signal handlers, so a single slideshow runs at a time
+static volatile sig_atomic_t interrupted = 0;
+static volatile sig_atomic_t resized = 0;
+static atomic_flag running = ATOMIC_FLAG_INIT;
+
+static void on_signal(int sig) {
+  if (sig == SIGWINCH)
+    resized = 1;
+  else
+    interrupted = 1;
+}
+
+int parse_interval(const char *str, long *interval) {
+  if (str == NULL)
+    return 1;
+  char *end;
+  double value = strtod(str, &end);
+  if (end == str || value <= 0)
+    return 1;
+
+  double scale;
+  if (strcmp(end, "ms") == 0)
+    scale = 1;
+  else if (strcmp(end, "s") == 0 || *end == '\0')
+    scale = 1000;
+  else if (strcmp(end, "m") == 0)
+    scale = 60 * 1000;
+  else if (strcmp(end, "h") == 0)
+    scale = 60 * 60 * 1000;
+  else
+    return 1;
+
+  *interval = (long)(value * scale);
+  return *interval > 0 ? 0 : 1;
+}
+
+/**
+ * @brief Sleep until the delay is over, the slideshow is interrupted or the
+ * terminal is resized.
+ *
+ * @param delay Time left to sleep, updated when the sleep is cut short
+ * @return 1 if the terminal was resized, otherwise 0
+ */
+static int wait_delay(struct timespec *delay) {
+  while (!interrupted && !resized) {
+    if (nanosleep(delay, delay) == 0 || errno != EINTR)
+      return 0;
+  }
+  return !interrupted && resized;
+}
+
+/**
+ * @brief Deadline of `pthread_cond_timedwait()`, some ms from now.
+ */
+static struct timespec deadline(long ms) {
+  struct timespec time;
+  clock_gettime(CLOCK_REALTIME, &time);
+  time.tv_sec += ms / 1000;
+  time.tv_nsec += (ms % 1000) * 1000000L;
+  if (time.tv_nsec >= 1000000000L) {
+    time.tv_sec++;
+    time.tv_nsec -= 1000000000L;
+  }
+  return time;
+}
+
+/**
+ * @brief Render a random card.
+ *
+ * @return A dynamically allocated string with the card, to free with
+ * `pokefetch_free_string()`, or `NULL`
+ */
+static char *render_random(struct WatchQueue *queue) {
+  struct WatchOptions *options = queue->options;
+  // The size of the terminal changes on SIGWINCH
+  pthread_mutex_lock(&queue->lock);
+  struct CardOptions card = options->card;
+  pthread_mutex_unlock(&queue->lock);
+
+  card.id = pokefetch_random_id(queue->ctx, &options->filter);
+  if (card.id == 0)
+    return NULL;
+  card.shiny = pokefetch_random(queue->ctx, 1, options->shiny_rate) == 1
+                   ? "shiny"
+                   : "regular";
+  return pokefetch_render_string(queue->ctx, &card);
+}
+
+/**
+ * @brief Background thread keeping the queue full.
+ */
+static void *prefetch(void *userdata) {
+  struct WatchQueue *queue = userdata;
+
+  pthread_mutex_lock(&queue->lock);
+  while (!queue->stop) {
+    if (queue->count == queue->options->prefetch) {
+      pthread_cond_wait(&queue->changed, &queue->lock);
+      continue;
+    }
+
+    // Fetch and render without holding the lock
+    pthread_mutex_unlock(&queue->lock);
+    char *card = render_random(queue);
+    pthread_mutex_lock(&queue->lock);
+
+    if (card == NULL) {
+      // Most likely the network, do not hammer the PokéAPI
+      struct timespec time = deadline(1000);
+      pthread_cond_timedwait(&queue->changed, &queue->lock, &time);
+      continue;
+    }
+    if (queue->stop) {
+      pokefetch_free_string(card);
+      break;
+    }
+    int tail = (queue->head + queue->count) % WATCH_MAX_PREFETCH;
+    queue->cards[tail] = card;
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return NULL;
+}
+
+/**
+ * @brief Take the next card of the queue, waiting for it if needed.
+ *
+ * @return The card, or `NULL` if the slideshow was interrupted
+ */
+static char *next_card(struct WatchQueue *queue) {
+  char *card = NULL;
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !interrupted) {
+    // Signals do not wake the condition, check them every 100 ms
+    struct timespec time = deadline(100);
+    pthread_cond_timedwait(&queue->changed, &queue->lock, &time);
+  }
+  if (queue->count > 0) {
+    card = queue->cards[queue->head];
+    queue->head = (queue->head + 1) % WATCH_MAX_PREFETCH;
+    queue->count--;
+    pthread_cond_broadcast(&queue->changed);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return card;
+}
+
+/**
+ * @brief Split a card in lines, in place.
+ *
+ * @return 0 if the card was split, otherwise 1
+ */
+static int split_frame(struct Frame *frame, char *text) {
+  frame->text = text;
+  frame->nb_lines = 0;
+  char *line = text;
+  while (*line) {
+    if (frame->nb_lines == frame->size) {
+      int size = frame->size ? frame->size * 2 : 64;
+      char **ptr = mem_realloc(frame->lines, size * sizeof(*ptr));
+      if (ptr == NULL)
+        return 1;
+      frame->lines = ptr;
+      frame->size = size;
+    }
+    frame->lines[frame->nb_lines++] = line;
+    char *end = strchr(line, '\n');
+    if (end == NULL)
+      break;
+    *end = '\0';
+    line = end + 1;
+  }
+  return 0;
+}
+
+static int append(struct Output *output, const char *data, size_t len) {
+  if (output->len + len > output->capacity) {
+    size_t capacity = output->capacity ? output->capacity : 4096;
+    while (output->len + len > capacity)
+      capacity *= 2;
+    char *ptr = mem_realloc(output->data, capacity);
+    if (ptr == NULL)
+      return 1;
+    output->data = ptr;
+    output->capacity = capacity;
+  }
+  memcpy(output->data + output->len, data, len);
+  output->len += len;
+  return 0;
+}
+
+/**
+ * @brief Replace the card on screen, only rewriting the lines that changed.
+ */
+static void redraw(FILE *out, struct Output *output, const struct Frame *old,
+                   const struct Frame *new) {
+  char move[32];
+  int height = old->nb_lines > new->nb_lines ? old->nb_lines : new->nb_lines;
+
+  output->len = 0;
+  for (int y = 0; y < height; y++) {
+    if (y < old->nb_lines && y < new->nb_lines &&
+        strcmp(old->lines[y], new->lines[y]) == 0)
+      continue;
+    int len = snprintf(move, sizeof(move), "\033[%d;1H", y + 1);
+    append(output, move, len);
+    if (y < new->nb_lines)
+      append(output, new->lines[y], strlen(new->lines[y]));
+    // Clear what is left of the old line
+    append(output, "\033[0m\033[K", strlen("\033[0m\033[K"));
+  }
+  fwrite(output->data, 1, output->len, out);
+  fflush(out);
+}
+
+/**
+ * @brief Redraw the whole card after the terminal was resized, the next cards
+ * being rendered for the new size.
+ */
+static void resize(FILE *out, struct Output *output, struct WatchQueue *queue,
+                   const struct Frame *frame) {
+  int columns, rows;
+  if (terminal_size(fileno(out), &columns, &rows) == 0) {
+    pthread_mutex_lock(&queue->lock);
+    queue->options->card.columns = columns;
+    queue->options->card.rows = rows;
+    pthread_mutex_unlock(&queue->lock);
+  }
+  // The terminal wrapped or cut the lines, none of them can be kept
+  struct Frame blank = {0};
+  fputs("\033[2J", out);
+  redraw(out, output, &blank, frame);
+}
+
+int show_watch(struct Pokefetch *ctx, struct WatchOptions *options, FILE *out) {
+  if (pokefetch_random_id(ctx, &options->filter) == 0) {
+    fprintf(stderr, "No pokemon matches the filters.\n");
+    return 1;
+  }
+  if (options->prefetch < 1)
+    options->prefetch = 1;
+  if (options->prefetch > WATCH_MAX_PREFETCH)
+    options->prefetch = WATCH_MAX_PREFETCH;
+  if (atomic_flag_test_and_set(&running)) {
+    fprintf(stderr, "Error in watch.c: A slideshow is already running.\n");
+    return 1;
+  }
+
+  interrupted = 0;
+  resized = 0;
+  struct WatchQueue queue = {0};
+  queue.ctx = ctx;
+  queue.options = options;
+  pthread_mutex_init(&queue.lock, NULL);
+  pthread_cond_init(&queue.changed, NULL);
+
+  // Only this thread handles the signals, the prefetch one blocks them. The
+  // handlers of the program are given back once the slideshow ends
+  struct sigaction action = {0}, old_int, old_term, old_winch;
+  action.sa_handler = on_signal;
+  // Writes to the terminal go on after a resize, the sleeps are cut short
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGINT, &action, &old_int);
+  sigaction(SIGTERM, &action, &old_term);
+  sigaction(SIGWINCH, &action, &old_winch);
+  sigset_t signals, previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGWINCH);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+  pthread_t thread;
+  int status = pthread_create(&thread, NULL, prefetch, &queue);
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if (status != 0) {
+    fprintf(stderr, "Error in watch.c: Failed to start the prefetch.\n");
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGWINCH, &old_winch, NULL);
+    pthread_cond_destroy(&queue.changed);
+    pthread_mutex_destroy(&queue.lock);
+    atomic_flag_clear(&running);
+    return 1;
+  }
+
+  // Two frames swapped at each card, the one on screen and the next one
+  struct Frame frames[2] = {{0}};
+  struct Output output = {0};
+  int current = 0;
+  fputs(SCREEN_ENTER, out);
+
+  while (!interrupted) {
+    char *card = next_card(&queue);
+    if (card == NULL)
+      break;
+    struct Frame *old = &frames[current];
+    struct Frame *new = &frames[1 - current];
+    if (split_frame(new, card) == 0) {
+      redraw(out, &output, old, new);
+      pokefetch_free_string(old->text);
+      old->text = NULL;
+      old->nb_lines = 0;
+      current = 1 - current;
+    } else {
+      pokefetch_free_string(card);
+      new->text = NULL;
+    }
+    struct timespec delay = {options->interval / 1000,
+                             (options->interval % 1000) * 1000000L};
+    while (wait_delay(&delay)) {
+      resized = 0;
+      resize(out, &output, &queue, &frames[current]);
+    }
+  }
+
+  fputs(SCREEN_LEAVE, out);
+  fflush(out);
+
+  pthread_mutex_lock(&queue.lock);
+  queue.stop = 1;
+  pthread_cond_broadcast(&queue.changed);
+  pthread_mutex_unlock(&queue.lock);
+  pthread_join(thread, NULL);
+  sigaction(SIGINT, &old_int, NULL);
+  sigaction(SIGTERM, &old_term, NULL);
+  sigaction(SIGWINCH, &old_winch, NULL);
+
+  for (int i = 0; i < queue.count; i++)
+    pokefetch_free_string(queue.cards[(queue.head + i) % WATCH_MAX_PREFETCH]);
+  for (int i = 0; i < 2; i++) {
+    pokefetch_free_string(frames[i].text);
+    mem_free(frames[i].lines);
+  }
+  mem_free(output.data);
+  pthread_cond_destroy(&queue.changed);
+  pthread_mutex_destroy(&queue.lock);
+  atomic_flag_clear(&running);
+  return 0;
+}
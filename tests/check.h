@@ -0,0 +1,45 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Minimal checks for the tests of `make test`: a failed check is reported
+ * with its line and the test goes on, `check_report()` gives the exit status.
+ */
+static int check_failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+              #cond);                                                          \
+      check_failures++;                                                        \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_STR(actual, expected)                                            \
+  do {                                                                         \
+    const char *check_a = (actual), *check_e = (expected);                     \
+    if (check_a == NULL || strcmp(check_a, check_e) != 0) {                    \
+      fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__,     \
+              __LINE__, #actual, check_a ? check_a : "(null)", check_e);       \
+      check_failures++;                                                        \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @brief Print the result of the checks of a test.
+ *
+ * @return 0 if every check passed, otherwise 1
+ */
+static inline int check_report(const char *name) {
+  if (check_failures == 0)
+    printf("%s: ok\n", name);
+  else
+    printf("%s: %d failed\n", name, check_failures);
+  return check_failures != 0;
+}
+
+#endif // !CHECK_H
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// personal files
+#include "../include/color.h"
+#include "../include/memstats.h"
+#include "check.h"
+
+#define NB_COLORS 200
+
+/**
+ * @brief Write a quantization table to a temporary file and load it.
+ *
+ * Entry `i` is the color `(i, 2 * i % 256, 7)`, quantized to `16 + i % 240`
+ * and `i % 16` so that a color found in the table is told apart from a
+ * computed one. Its shiny color is `(7, i, 2 * i % 256)`.
+ *
+ * @return 0 if the table was loaded, otherwise 1
+ */
+static int make_palette(struct Palette *palette, int nb_colors) {
+  char filename[] = "/tmp/test_color_XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0)
+    return 1;
+  FILE *file = fdopen(fd, "w");
+  for (int i = 0; i < nb_colors; i++)
+    fprintf(file, "%d %d 7 %d %d 7 %d %d %d %d\n", i, 2 * i % 256,
+            16 + i % 240, i % 16, i, 2 * i % 256, 16 + (i + 1) % 240,
+            (i + 1) % 16);
+  // The first entry of a color is the one used
+  fprintf(file, "0 0 7 255 15 0 0 0 255 15\n");
+  fclose(file);
+
+  int status = load_palette(filename, palette);
+  unlink(filename);
+  return status;
+}
+
+static void check_color(const char *icon, enum ColorMode mode,
+                        const struct Palette *palette, int shiny,
+                        const char *expected) {
+  char *result = color_icon(icon, mode, palette, shiny);
+  CHECK_STR(result, expected);
+  mem_free(result);
+}
+
+static void test_lookup(void) {
+  struct Palette palette;
+  if (make_palette(&palette, NB_COLORS) != 0) {
+    CHECK(!"the palette could not be loaded");
+    return;
+  }
+  CHECK(palette.size == NB_COLORS + 1);
+  CHECK(palette.nb_slots >= 2 * palette.size);
+
+  // Every color is found, whatever the collisions of the index
+  for (int i = 0; i < NB_COLORS; i++) {
+    char icon[64], expected[64];
+    snprintf(icon, sizeof(icon), "\033[38;2;%d;%d;7m▀\033[0m", i,
+             2 * i % 256);
+    snprintf(expected, sizeof(expected), "\033[38;5;%dm▀\033[0m",
+             16 + i % 240);
+    check_color(icon, COLOR_256, &palette, 0, expected);
+    snprintf(expected, sizeof(expected), "\033[48;5;%dm▀\033[0m",
+             16 + (i + 1) % 240);
+    icon[2] = '4';
+    check_color(icon, COLOR_256, &palette, 1, expected);
+    snprintf(expected, sizeof(expected), "\033[48;2;7;%d;%dm▀\033[0m", i,
+             2 * i % 256);
+    check_color(icon, COLOR_TRUE, &palette, 1, expected);
+  }
+
+  // 16 colors, from the table
+  check_color("\033[38;2;17;34;7m▄", COLOR_16, &palette, 0, "\033[31m▄");
+
+  // Missing colors are quantized on the fly, and kept in truecolor
+  check_color("\033[38;2;255;255;255m▀", COLOR_256, &palette, 0,
+              "\033[38;5;231m▀");
+  check_color("\033[38;2;255;255;255m▀", COLOR_TRUE, &palette, 1,
+              "\033[38;2;255;255;255m▀");
+  free_palette(&palette);
+  CHECK(palette.slots == NULL && palette.size == 0);
+}
+
+static void test_empty(void) {
+  // No table at all
+  struct Palette palette;
+  CHECK(load_palette("/nonexistent/icon.pal", &palette) != 0);
+  CHECK(palette.size == 0 && palette.slots == NULL);
+  check_color("\033[38;2;255;0;0m▀\033[0m", COLOR_256, &palette, 0,
+              "\033[38;5;196m▀\033[0m");
+  check_color("\033[38;2;255;0;0m▀\033[0m", COLOR_NONE, &palette, 0, "▀");
+  free_palette(&palette);
+}
+
+int main(void) {
+  test_lookup();
+  test_empty();
+  return check_report("test_color");
+}
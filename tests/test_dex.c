@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// personal files
+#include "../include/dex.h"
+#include "check.h"
+
+// More than two words of each bitset
+#define NB_SPECIES 150
+
+#define FIRE 9
+#define WATER 10
+
+/**
+ * @brief Columns of the species of ID `id` in the test index.
+ *
+ * Each species has the type `id % DEX_NB_TYPES`, every fourth one is also
+ * fire, the generation changes every 20 species, every 25th species is
+ * legendary and every 30th is mythical (so every 150th is both).
+ */
+static void make_row(int id, struct DexRow *row) {
+  memset(row, 0, sizeof(*row));
+  row->types[0] = id % DEX_NB_TYPES;
+  row->types[1] = id % 4 == 0 && row->types[0] != FIRE ? FIRE : 0xFF;
+  row->gen = 1 + (id - 1) / 20;
+  if (id % 25 == 0)
+    row->flags |= DEX_LEGENDARY;
+  if (id % 30 == 0)
+    row->flags |= DEX_MYTHICAL;
+  row->stats[0] = id % 256;
+}
+
+/**
+ * @brief Whether the species of ID `id` matches a filter, the slow way.
+ */
+static int matches(int id, const struct DexFilter *filter) {
+  struct DexRow row;
+  make_row(id, &row);
+  for (int t = 0; t < DEX_NB_TYPES; t++) {
+    if ((filter->types & (1u << t)) && row.types[0] != t && row.types[1] != t)
+      return 0;
+  }
+  if (filter->gens && !(filter->gens & (1u << (row.gen - 1))))
+    return 0;
+  int rare = (filter->legendary && (row.flags & DEX_LEGENDARY)) ||
+             (filter->mythical && (row.flags & DEX_MYTHICAL));
+  if ((filter->legendary || filter->mythical) && !rare)
+    return 0;
+  return 1;
+}
+
+/**
+ * @brief Write the test index in a temporary directory and load it.
+ *
+ * @return 0 if the index was loaded, otherwise 1
+ */
+static int make_index(struct DexIndex *index) {
+  char dir[] = "/tmp/test_dex_XXXXXX";
+  if (mkdtemp(dir) == NULL)
+    return 1;
+  struct DexRow rows[NB_SPECIES];
+  for (int id = 1; id <= NB_SPECIES; id++)
+    make_row(id, &rows[id - 1]);
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/index.bin", dir);
+  int status = dex_write(path, rows, NB_SPECIES) != 0 ||
+               dex_load(index, dir, 0) != 0;
+  unlink(path);
+  rmdir(dir);
+  return status;
+}
+
+static void test_parse(void) {
+  CHECK(dex_type("fire") == FIRE);
+  CHECK(dex_type("fairy") == DEX_NB_TYPES - 1);
+  CHECK(dex_type("Fire") == -1 && dex_type("") == -1);
+  CHECK(strcmp(dex_type_name(WATER), "water") == 0);
+  CHECK(dex_type_name(DEX_NB_TYPES) == NULL && dex_type_name(-1) == NULL);
+  CHECK(dex_generation("generation-iv") == 4);
+  CHECK(dex_generation("generation-x") == 0);
+
+  uint16_t gens = 0;
+  CHECK(dex_parse_gens("2", &gens) == 0 && gens == 0x2);
+  gens = 0;
+  CHECK(dex_parse_gens("1-3,5", &gens) == 0 && gens == 0x17);
+  gens = 0;
+  CHECK(dex_parse_gens("9,1-1", &gens) == 0 && gens == 0x101);
+  // The generations are added to the ones given before
+  CHECK(dex_parse_gens("4", &gens) == 0 && gens == 0x109);
+
+  const char *invalid[] = {"0",    "10", "3-1", "1-",  "-2",
+                           "1,,2", "a",  "1-10", "2x", "1;2"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    gens = 0;
+    if (dex_parse_gens(invalid[i], &gens) == 0) {
+      fprintf(stderr, "accepted invalid generations: %s\n", invalid[i]);
+      check_failures++;
+    }
+  }
+  CHECK(dex_parse_gens(NULL, &gens) != 0);
+}
+
+/**
+ * @brief Check the selection and the picks of a filter against `matches()`.
+ *
+ * @return The number of matching species
+ */
+static int check_filter(const struct DexIndex *index,
+                        const struct DexFilter *filter) {
+  int expected[NB_SPECIES], nb_expected = 0;
+  for (int id = 1; id <= NB_SPECIES; id++) {
+    if (matches(id, filter))
+      expected[nb_expected++] = id;
+  }
+
+  int ids[NB_SPECIES];
+  int nb = dex_select(index, filter, ids, NB_SPECIES);
+  CHECK(nb == nb_expected);
+  CHECK(dex_count(index, filter) == nb_expected);
+  CHECK(memcmp(ids, expected, nb_expected * sizeof(int)) == 0);
+
+  // The n-th random number picks the n-th species, so each one is reachable
+  for (int i = 0; i < 2 * nb_expected; i++)
+    CHECK(dex_pick(index, filter, i) == expected[i % nb_expected]);
+  if (nb_expected == 0)
+    CHECK(dex_pick(index, filter, 12345) == 0);
+  return nb_expected;
+}
+
+static void test_select(void) {
+  struct DexIndex index;
+  if (make_index(&index) != 0) {
+    CHECK(!"the index could not be loaded");
+    return;
+  }
+  CHECK(index.count == NB_SPECIES && index.has_types);
+
+  struct DexRow row;
+  dex_row(&index, 100, &row);
+  CHECK(row.types[0] == WATER && row.types[1] == FIRE);
+  CHECK(row.gen == 5 && row.flags == DEX_LEGENDARY && row.stats[0] == 100);
+
+  // Everything
+  struct DexFilter filter = {0};
+  CHECK(check_filter(&index, &filter) == NB_SPECIES);
+
+  // Types must all match
+  filter.types = 1u << FIRE;
+  int fire = check_filter(&index, &filter);
+  filter.types |= 1u << WATER;
+  int fire_water = check_filter(&index, &filter);
+  CHECK(fire_water > 0 && fire_water < fire);
+
+  // Generations are alternatives
+  filter = (struct DexFilter){0};
+  filter.gens = 0x1;
+  CHECK(check_filter(&index, &filter) == 20);
+  filter.gens = 0x5;
+  CHECK(check_filter(&index, &filter) == 40);
+  filter.gens = 1u << (DEX_NB_GENERATIONS - 1);
+  CHECK(check_filter(&index, &filter) == 0);
+
+  // Legendary or mythical, either flag when both are given
+  filter = (struct DexFilter){0};
+  filter.legendary = 1;
+  CHECK(check_filter(&index, &filter) == 6);
+  filter.legendary = 0;
+  filter.mythical = 1;
+  CHECK(check_filter(&index, &filter) == 5);
+  filter.legendary = 1;
+  CHECK(check_filter(&index, &filter) == 10);
+
+  // Everything at once
+  filter.types = 1u << FIRE;
+  filter.gens = 0x3e;
+  check_filter(&index, &filter);
+
+  // Fewer IDs than matches
+  int ids[4];
+  filter = (struct DexFilter){0};
+  CHECK(dex_select(&index, &filter, ids, 4) == 4);
+  CHECK(ids[0] == 1 && ids[3] == 4);
+  dex_free(&index);
+}
+
+static void test_fallback(void) {
+  // Without `index.bin`, only the generations are known
+  struct DexIndex index;
+  CHECK(dex_load(&index, "/nonexistent", 0) != 0);
+  if (dex_load(&index, "/nonexistent", 300) != 0) {
+    CHECK(!"the fallback index could not be built");
+    return;
+  }
+  CHECK(index.count == 300 && !index.has_types);
+
+  int ids[300];
+  struct DexFilter filter = {0};
+  filter.gens = 0x1;
+  CHECK(dex_select(&index, &filter, ids, 300) == 151);
+  CHECK(ids[0] == 1 && ids[150] == 151);
+  filter.gens = 0x4;
+  CHECK(dex_select(&index, &filter, ids, 300) == 300 - 251);
+  CHECK(ids[0] == 252);
+  CHECK(dex_pick(&index, &filter, 0) == 252);
+
+  // No species has a type or a rarity
+  filter = (struct DexFilter){0};
+  filter.types = 1u << FIRE;
+  CHECK(dex_count(&index, &filter) == 0);
+  filter = (struct DexFilter){0};
+  filter.legendary = 1;
+  CHECK(dex_pick(&index, &filter, 7) == 0);
+  dex_free(&index);
+}
+
+int main(void) {
+  test_parse();
+  test_select();
+  test_fallback();
+  return check_report("test_dex");
+}
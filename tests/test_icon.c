@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/icon.h"
+#include "../include/memstats.h"
+#include "check.h"
+
+#define RED "\033[38;2;230;40;40m"
+#define GREEN_BG "\033[48;2;60;160;40m"
+#define BLUE "\033[38;2;40;130;240m"
+#define RESET "\033[0m"
+
+/**
+ * @brief Write a `.pki` icon with two colors: 1 is red, blue when shiny, and
+ * 2 is green.
+ *
+ * @return The size of the icon
+ */
+static size_t make_icon(unsigned char *data, int width, int height,
+                        const unsigned char *runs, size_t nb_runs) {
+  static const unsigned char palette[] = {
+      230, 40, 40, 160, 9, 40, 130, 240, 33, 12,
+      60, 160, 40, 70, 2, 60, 160, 40, 70, 2,
+  };
+  unsigned char header[ICON_HEADER_SIZE] = {
+      'P', 'K', 'I', 1, width & 0xFF, width >> 8, height & 0xFF, height >> 8,
+      2,   0};
+  memcpy(data, header, sizeof(header));
+  memcpy(data + sizeof(header), palette, sizeof(palette));
+  memcpy(data + sizeof(header) + sizeof(palette), runs, 3 * nb_runs);
+  return sizeof(header) + sizeof(palette) + 3 * nb_runs;
+}
+
+static void check_icon(const unsigned char *data, size_t size,
+                       enum ColorMode mode, int shiny, const char *expected) {
+  char *icon = decode_icon(data, size, mode, shiny);
+  CHECK_STR(icon, expected);
+  mem_free(icon);
+}
+
+static void test_decode(void) {
+  unsigned char data[256];
+  // Two lines of three cells: red over nothing, twice, then red over green,
+  // and a run going on to the next line
+  const unsigned char runs[] = {2, 1, 0, 2, 1, 2, 2, 0, 0};
+  size_t size = make_icon(data, 3, 2, runs, 3);
+
+  check_icon(data, size, COLOR_NONE, 0, "▀▀▀\n▀  \n");
+  check_icon(data, size, COLOR_TRUE, 0,
+             RED "▀" RESET RED "▀" RESET RED GREEN_BG "▀" RESET "\n"
+             RED GREEN_BG "▀" RESET "  \n");
+  check_icon(data, size, COLOR_TRUE, 1,
+             BLUE "▀" RESET BLUE "▀" RESET BLUE GREEN_BG "▀" RESET "\n"
+             BLUE GREEN_BG "▀" RESET "  \n");
+  check_icon(data, size, COLOR_256, 0,
+             "\033[38;5;160m▀" RESET "\033[38;5;160m▀" RESET
+             "\033[38;5;160m\033[48;5;70m▀" RESET "\n"
+             "\033[38;5;160m\033[48;5;70m▀" RESET "  \n");
+
+  // Only the bottom pixel
+  const unsigned char lower[] = {1, 0, 1};
+  size = make_icon(data, 1, 1, lower, 1);
+  check_icon(data, size, COLOR_TRUE, 0, RED "▄" RESET "\n");
+}
+
+static void test_invalid(void) {
+  unsigned char data[256];
+  const unsigned char runs[] = {2, 1, 0, 2, 1, 2, 2, 0, 0};
+  size_t size = make_icon(data, 3, 2, runs, 3);
+
+  // Cut anywhere, header, palette or runs
+  for (size_t len = 0; len < size; len++) {
+    unsigned char *cut = malloc(len ? len : 1);
+    memcpy(cut, data, len);
+    char *icon = decode_icon(cut, len, COLOR_TRUE, 0);
+    if (icon != NULL) {
+      fprintf(stderr, "accepted icon cut at %zu\n", len);
+      check_failures++;
+      mem_free(icon);
+    }
+    free(cut);
+  }
+
+  // No cells, whatever the other dimension
+  size = make_icon(data, 0, 5, runs, 3);
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+  size = make_icon(data, 5, 0, runs, 3);
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+
+  // More cells than the runs can cover
+  size = make_icon(data, 0xFFFF, 0xFFFF, runs, 3);
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+
+  // Color missing from the palette
+  const unsigned char unknown[] = {1, 3, 0};
+  size = make_icon(data, 1, 1, unknown, 1);
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+
+  // Empty run
+  const unsigned char empty[] = {0, 1, 0, 1, 1, 0};
+  size = make_icon(data, 1, 1, empty, 2);
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+
+  // Wrong magic
+  size = make_icon(data, 3, 2, runs, 3);
+  data[3] = 2;
+  CHECK(decode_icon(data, size, COLOR_TRUE, 0) == NULL);
+}
+
+int main(void) {
+  test_decode();
+  test_invalid();
+  return check_report("test_icon");
+}
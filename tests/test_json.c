@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// personal files
+#include "../include/json.h"
+#include "../include/memstats.h"
+#include "check.h"
+
+/**
+ * @brief Parse a document from a C string, the test fails if it is invalid.
+ */
+static int parse(struct JsonDoc *doc, const char *text) {
+  int status = json_parse(doc, text, strlen(text));
+  CHECK(status == 0);
+  return status;
+}
+
+/**
+ * @brief Decode the single string of a document.
+ */
+static char *decode(const char *text) {
+  struct JsonDoc doc;
+  if (parse(&doc, text) != 0)
+    return NULL;
+  char *str = json_strdup(&doc, 0);
+  json_free(&doc);
+  return str;
+}
+
+static void test_tape(void) {
+  const char *text = "{\"a\": [1, -2, {\"b\": null}], \"c\": \"x\", \"d\": {}}";
+  struct JsonDoc doc;
+  if (parse(&doc, text) != 0)
+    return;
+
+  // object, "a", array, 1, -2, object, "b", null, "c", "x", "d", object
+  CHECK(doc.nb_tokens == 12);
+  CHECK(json_type(&doc, 0) == JSON_OBJECT);
+  CHECK(json_size(&doc, 0) == 3);
+  int a = json_get(&doc, 0, "a");
+  CHECK(json_type(&doc, a) == JSON_ARRAY);
+  CHECK(json_size(&doc, a) == 3);
+  CHECK(json_int(&doc, json_item(&doc, a, 1)) == -2);
+  CHECK(json_item(&doc, a, 3) == -1);
+  int b = json_get(&doc, json_item(&doc, a, 2), "b");
+  CHECK(json_type(&doc, b) == JSON_NULL);
+  CHECK(json_equals(&doc, json_get(&doc, 0, "c"), "x"));
+  CHECK(json_size(&doc, json_get(&doc, 0, "d")) == 0);
+  CHECK(json_first(&doc, json_get(&doc, 0, "d")) == -1);
+  CHECK(json_get(&doc, 0, "missing") == -1);
+
+  // Keys in order, each followed by its value
+  int keys = 0;
+  for (int key = json_first(&doc, 0); key >= 0; key = json_next(&doc, 0, key))
+    keys++;
+  CHECK(keys == 3);
+
+  // The tokens that do not fit are counted, like snprintf()
+  struct JsonToken tokens[4];
+  CHECK(json_tokenize(text, strlen(text), tokens, 4) == 12);
+  CHECK(json_tokenize(text, strlen(text), NULL, 0) == 12);
+  json_free(&doc);
+}
+
+static void test_invalid(void) {
+  const char *invalid[] = {"",      "{",       "[1,]",   "{\"a\" 1}",
+                           "[1 2]", "\"abc",   "{\"a\":}", "[nul]",
+                           "]",     "{\"a\":1]", "[1]]",  "tru"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    if (json_tokenize(invalid[i], strlen(invalid[i]), NULL, 0) >= 0) {
+      fprintf(stderr, "accepted invalid document: %s\n", invalid[i]);
+      check_failures++;
+    }
+  }
+
+  // A document cut anywhere is rejected, and never read past its size
+  const char *text = "{\"name\": \"Pok\\u00e9mon\", \"ids\": [1, 2, 3], "
+                     "\"ok\": true}";
+  size_t size = strlen(text);
+  for (size_t len = 0; len < size; len++) {
+    char *cut = malloc(len ? len : 1);
+    memcpy(cut, text, len);
+    if (json_tokenize(cut, len, NULL, 0) >= 0) {
+      fprintf(stderr, "accepted document cut at %zu\n", len);
+      check_failures++;
+    }
+    free(cut);
+  }
+
+  // Nesting deeper than JSON_MAX_DEPTH
+  char deep[2 * JSON_MAX_DEPTH + 3];
+  memset(deep, '[', JSON_MAX_DEPTH + 1);
+  memset(deep + JSON_MAX_DEPTH + 1, ']', JSON_MAX_DEPTH + 1);
+  CHECK(json_tokenize(deep, 2 * JSON_MAX_DEPTH + 2, NULL, 0) < 0);
+}
+
+static void test_escapes(void) {
+  char *str = decode("\"a\\\"b\\\\c\\/d\\n\\t\\b\\f\\r\"");
+  CHECK_STR(str, "a\"b\\c/d\n\t\b\f\r");
+  mem_free(str);
+
+  // One, two and three bytes of UTF-8
+  str = decode("\"\\u0041\\u00e9\\u20ac\"");
+  CHECK_STR(str, "A\xc3\xa9\xe2\x82\xac");
+  mem_free(str);
+
+  // Raw UTF-8 is kept as is
+  str = decode("\"Pok\xc3\xa9mon\"");
+  CHECK_STR(str, "Pok\xc3\xa9mon");
+  mem_free(str);
+
+  // Unknown escapes keep their character
+  str = decode("\"\\q\"");
+  CHECK_STR(str, "q");
+  mem_free(str);
+
+  struct JsonDoc doc;
+  if (parse(&doc, "[\"caf\\u00e9\"]") == 0) {
+    CHECK(json_equals(&doc, 1, "caf\xc3\xa9"));
+    CHECK(!json_equals(&doc, 1, "cafe"));
+    CHECK(!json_equals(&doc, 1, "caf\xc3\xa9s"));
+    json_free(&doc);
+  }
+}
+
+static void test_surrogates(void) {
+  // U+1F600 as a surrogate pair
+  char *str = decode("\"\\ud83d\\ude00\"");
+  CHECK_STR(str, "\xf0\x9f\x98\x80");
+  mem_free(str);
+
+  // Lone or mismatched surrogates become U+FFFD
+  str = decode("\"\\ud83dx\"");
+  CHECK_STR(str, "\xef\xbf\xbdx");
+  mem_free(str);
+  str = decode("\"\\ude00\"");
+  CHECK_STR(str, "\xef\xbf\xbd");
+  mem_free(str);
+  str = decode("\"\\ud83d\\u0041\"");
+  CHECK_STR(str, "\xef\xbf\xbd" "A");
+  mem_free(str);
+  str = decode("\"\\ud83d\"");
+  CHECK_STR(str, "\xef\xbf\xbd");
+  mem_free(str);
+
+  // Invalid hexadecimal digits
+  str = decode("\"\\u12g4\"");
+  CHECK(str != NULL);
+  mem_free(str);
+}
+
+static void test_truncation(void) {
+  struct JsonDoc doc;
+  if (parse(&doc, "\"ab\\u00e9c\"") != 0)
+    return;
+
+  // The whole length is returned, like snprintf()
+  char buf[8];
+  CHECK(json_decode(&doc, 0, NULL, 0) == 5);
+  CHECK(json_decode(&doc, 0, buf, sizeof(buf)) == 5);
+  CHECK_STR(buf, "ab\xc3\xa9" "c");
+
+  // Characters are never cut in half
+  CHECK(json_decode(&doc, 0, buf, 4) == 5);
+  CHECK_STR(buf, "ab");
+  CHECK(json_decode(&doc, 0, buf, 5) == 5);
+  CHECK_STR(buf, "ab\xc3\xa9");
+  CHECK(json_decode(&doc, 0, buf, 1) == 5);
+  CHECK_STR(buf, "");
+  json_free(&doc);
+
+  // Strings without escape sequences are copied as they are
+  if (parse(&doc, "\"abcdef\"") != 0)
+    return;
+  CHECK(json_decode(&doc, 0, buf, 4) == 6);
+  CHECK_STR(buf, "abc");
+  json_free(&doc);
+
+  // A backslash followed by a NUL byte, as in a corrupted mapped file
+  const char text[] = {'"', '\\', '\0', '"'};
+  if (json_parse(&doc, text, sizeof(text)) == 0) {
+    CHECK(json_decode(&doc, 0, buf, sizeof(buf)) == 1);
+    CHECK(buf[0] == '\0');
+    json_free(&doc);
+  }
+}
+
+// Tapes allocated or grown, through the hooks of memstats.h
+static int nb_reallocs = 0;
+
+static void *count_realloc(void *ptr, size_t size) {
+  nb_reallocs++;
+  return realloc(ptr, size);
+}
+
+static void test_temp(void) {
+  const char *text = "{\"a\": [1, 2, 3], \"b\": \"x\"}";
+  void *(*previous)(void *, size_t) = mem_realloc;
+  mem_realloc = count_realloc;
+
+  // The tape of the thread is kept from one document to the next
+  struct JsonDoc doc;
+  CHECK(json_parse_temp(&doc, text, strlen(text)) == 0);
+  json_free(&doc);
+  nb_reallocs = 0;
+  for (int i = 0; i < 10; i++) {
+    CHECK(json_parse_temp(&doc, text, strlen(text)) == 0);
+    CHECK(json_int(&doc, json_item(&doc, json_get(&doc, 0, "a"), 2)) == 3);
+    json_free(&doc);
+  }
+  CHECK(json_parse_temp(&doc, "[1]", 3) == 0);
+  json_free(&doc);
+  CHECK(nb_reallocs == 0);
+
+  // A second document while the first one holds the tape gets its own
+  struct JsonDoc inner;
+  CHECK(json_parse_temp(&doc, text, strlen(text)) == 0);
+  CHECK(json_parse_temp(&inner, "[true]", 6) == 0);
+  CHECK(nb_reallocs == 1);
+  CHECK(inner.tokens != doc.tokens && !inner.temp);
+  CHECK(json_type(&inner, 1) == JSON_TRUE);
+  CHECK(json_equals(&doc, json_get(&doc, 0, "b"), "x"));
+  json_free(&inner);
+  json_free(&doc);
+
+  // An invalid document leaves the tape free for the next one
+  CHECK(json_parse_temp(&doc, "[1,", 3) != 0);
+  nb_reallocs = 0;
+  CHECK(json_parse_temp(&doc, text, strlen(text)) == 0);
+  CHECK(nb_reallocs == 0 && doc.temp);
+  json_free(&doc);
+  mem_realloc = previous;
+}
+
+int main(void) {
+  test_tape();
+  test_invalid();
+  test_escapes();
+  test_surrogates();
+  test_truncation();
+  test_temp();
+  return check_report("test_json");
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+// personal files
+#include "../include/pokefetch.h"
+#include "../include/scheduler.h"
+#include "check.h"
+
+// Order in which the callbacks ran, by task ID
+static int order[16];
+static int nb_done = 0;
+
+static void on_done(struct Scheduler *sched, int task, void *userdata) {
+  (void)sched;
+  (void)userdata;
+  if (nb_done < 16)
+    order[nb_done++] = task;
+}
+
+// Adds a task depending on the one just done, as on_chain() in card.c
+static void on_grow(struct Scheduler *sched, int task, void *userdata) {
+  on_done(sched, task, userdata);
+  int *added = userdata;
+  *added = scheduler_add(sched, NULL, &task, 1, on_done, NULL);
+}
+
+static void test_order(struct Pokefetch *ctx) {
+  struct Scheduler *sched = scheduler_new(ctx, 4);
+  if (sched == NULL) {
+    CHECK(!"no scheduler");
+    return;
+  }
+  nb_done = 0;
+  int added = -1;
+  int a = scheduler_add(sched, NULL, NULL, 0, on_done, NULL);
+  int b = scheduler_add(sched, NULL, &a, 1, on_grow, &added);
+  int deps[2] = {a, b};
+  int c = scheduler_add(sched, NULL, deps, 2, on_done, NULL);
+  CHECK(a == 0 && b == 1 && c == 2);
+
+  CHECK(scheduler_run(sched) == 0);
+  CHECK(added == 3);
+  CHECK(nb_done == 4);
+  CHECK(order[0] == a && order[1] == b);
+  // c and the task added by b only wait for done tasks
+  CHECK((order[2] == c && order[3] == added) ||
+        (order[2] == added && order[3] == c));
+  scheduler_free(sched);
+}
+
+static void test_invalid_deps(struct Pokefetch *ctx) {
+  struct Scheduler *sched = scheduler_new(ctx, 4);
+  if (sched == NULL) {
+    CHECK(!"no scheduler");
+    return;
+  }
+  nb_done = 0;
+  int a = scheduler_add(sched, NULL, NULL, 0, on_done, NULL);
+
+  // A failed add (-1), an unknown task or the task itself are rejected
+  int failed = -1;
+  CHECK(scheduler_add(sched, NULL, &failed, 1, on_done, NULL) == -1);
+  int unknown = 5;
+  CHECK(scheduler_add(sched, NULL, &unknown, 1, on_done, NULL) == -1);
+  int self = 1;
+  CHECK(scheduler_add(sched, NULL, &self, 1, on_done, NULL) == -1);
+  int deps[2] = {a, -1};
+  CHECK(scheduler_add(sched, NULL, deps, 2, on_done, NULL) == -1);
+
+  // Nothing was added
+  CHECK(scheduler_add(sched, NULL, &a, 1, on_done, NULL) == 1);
+  CHECK(scheduler_run(sched) == 0);
+  CHECK(nb_done == 2);
+  scheduler_free(sched);
+}
+
+static void test_failure(struct Pokefetch *ctx) {
+  char filename[] = "/tmp/test_scheduler_XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0 || write(fd, "{}", 2) != 2) {
+    CHECK(!"no temporary file");
+    return;
+  }
+  close(fd);
+
+  struct Scheduler *sched = scheduler_new(ctx, 4);
+  if (sched == NULL) {
+    CHECK(!"no scheduler");
+    unlink(filename);
+    return;
+  }
+  nb_done = 0;
+  char url[64];
+  snprintf(url, sizeof(url), "file://%s", filename);
+  int found = scheduler_add(sched, url, NULL, 0, on_done, NULL);
+  int missing = scheduler_add(sched, "file:///nonexistent/pokefetch", NULL, 0,
+                              on_done, NULL);
+  int deps[2] = {found, missing};
+  int join = scheduler_add(sched, NULL, deps, 2, on_done, NULL);
+
+  CHECK(scheduler_run(sched) == 2);
+  CHECK_STR(scheduler_body(sched, found), "{}");
+  CHECK(!scheduler_failed(sched, found));
+  CHECK(scheduler_body(sched, missing) == NULL);
+  CHECK(scheduler_failed(sched, missing));
+  // The join fails with its dependency, once both are finished
+  CHECK(scheduler_failed(sched, join));
+  CHECK(nb_done == 3 && order[2] == join);
+  scheduler_free(sched);
+  unlink(filename);
+}
+
+int main(void) {
+  struct Pokefetch *ctx = pokefetch_new(NULL, NULL);
+  if (ctx == NULL) {
+    fprintf(stderr, "Error in test_scheduler.c: No context.\n");
+    return 1;
+  }
+  test_order(ctx);
+  test_invalid_deps(ctx);
+  test_failure(ctx);
+  pokefetch_free(ctx);
+  return check_report("test_scheduler");
+}